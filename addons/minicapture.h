@@ -0,0 +1,418 @@
+#ifndef MINICAPTURE_H
+#define MINICAPTURE_H
+
+typedef enum { CAPTURE_RAW, CAPTURE_PPM, CAPTURE_PNG } CaptureFormat;
+
+// Frames read back from the window, written to disk, and dropped because
+// the writer had no free slot
+typedef struct {
+  int captured;
+  int written;
+  int dropped;
+} CaptureStats;
+
+// pattern is a printf format for the frame number, e.g. "frames/%05d.png".
+// frames is how many to capture, 0 until captureStop.
+int captureStart(const char *pattern, CaptureFormat format, int frames);
+void captureStop();
+CaptureStats captureStats();
+
+#endif // MINICAPTURE_H
+
+#ifdef MINI_IMPLEMENTATION
+  // Frames are read back through a ring of pixel pack buffers, so the copy
+  // that glReadPixels starts is only mapped MINI_CAPTURE_PBOS frames later,
+  // long after the GPU finished it. The mapped pixels are copied into one of
+  // MINI_CAPTURE_SLOTS buffers that a background thread encodes and writes;
+  // when all of them are still being written the frame is dropped rather
+  // than stalling the render loop.
+  #ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+  #else
+    #include <pthread.h>
+  #endif
+  
+  #ifndef MINI_CAPTURE_PBOS
+    #define MINI_CAPTURE_PBOS 3
+  #endif
+  
+  #ifndef MINI_CAPTURE_SLOTS
+    #define MINI_CAPTURE_SLOTS 4
+  #endif
+  
+  typedef struct {
+    unsigned char *pixels;
+    int frame;
+    atomic_int ready;
+  } CaptureSlot;
+  
+  typedef struct {
+    char pattern[256];
+    CaptureFormat format;
+    int limit;
+    int frame;
+    int w;
+    int h;
+    int active;
+    int running;
+    atomic_int finished;
+    atomic_int written;
+    CaptureStats stats;
+    CaptureSlot slots[MINI_CAPTURE_SLOTS];
+    int slot;
+    #ifdef _WIN32
+      HANDLE thread;
+    #else
+      pthread_t thread;
+    #endif
+    #ifndef MINI_BACKEND_SOFTWARE
+      GLuint pbos[MINI_CAPTURE_PBOS];
+      int pending[MINI_CAPTURE_PBOS];
+      int pbo;
+    #endif
+  } Capture;
+  
+  Capture capture;
+  
+  // --- ENCODING --- //
+  static unsigned int _crc32(unsigned int crc, const unsigned char *data, size_t n) {
+    static unsigned int table[256];
+    if (!table[1]) {
+      for (unsigned int i = 0; i < 256; ++i) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; ++k) { c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1; }
+        table[i] = c;
+      }
+    }
+    
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) { crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+    return ~crc;
+  }
+  
+  static void _pngWrite(FILE *file, unsigned int *crc, const void *data, size_t n) {
+    fwrite(data, 1, n, file);
+    *crc = _crc32(*crc, data, n);
+  }
+  
+  static void _pngChunk(FILE *file, unsigned int *crc, const char *type, size_t length) {
+    unsigned char header[8] = {length >> 24, length >> 16, length >> 8, length, type[0], type[1], type[2], type[3]};
+    fwrite(header, 1, 4, file);
+    *crc = 0;
+    _pngWrite(file, crc, header + 4, 4);
+  }
+  
+  static void _pngEnd(FILE *file, unsigned int crc) {
+    unsigned char bytes[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+    fwrite(bytes, 1, 4, file);
+  }
+  
+  // Uncompressed: stored deflate blocks keep encoding as cheap as a copy
+  static void _pngSave(FILE *file, const unsigned char *rows[], int w, int h) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, 8, file);
+    
+    unsigned int crc;
+    unsigned char ihdr[13] = {w >> 24, w >> 16, w >> 8, w, h >> 24, h >> 16, h >> 8, h, 8, 6, 0, 0, 0};
+    _pngChunk(file, &crc, "IHDR", 13);
+    _pngWrite(file, &crc, ihdr, 13);
+    _pngEnd(file, crc);
+    
+    size_t stride = (size_t)w * 4 + 1;
+    size_t raw = stride * h;
+    size_t blocks = (raw + 65534) / 65535;
+    _pngChunk(file, &crc, "IDAT", 2 + raw + blocks * 5 + 4);
+    
+    unsigned char zlib[2] = {0x78, 0x01};
+    _pngWrite(file, &crc, zlib, 2);
+    
+    // Walk the filter bytes and rows as one stream cut into blocks
+    unsigned int a = 1, b = 0;
+    size_t offset = 0;
+    int y = 0;
+    size_t x = 0;
+    
+    while (offset < raw) {
+      size_t n = raw - offset < 65535 ? raw - offset : 65535;
+      unsigned char header[5] = {offset + n == raw, n, n >> 8, ~n, ~n >> 8};
+      _pngWrite(file, &crc, header, 5);
+      
+      for (size_t left = n; left > 0;) {
+        const unsigned char *src;
+        size_t run;
+        static const unsigned char filter = 0;
+        
+        if (x == 0) {
+          src = &filter;
+          run = 1;
+        } else {
+          src = rows[y] + x - 1;
+          run = stride - x < left ? stride - x : left;
+        }
+        
+        _pngWrite(file, &crc, src, run);
+        
+        // Sums stay below 2^32 for 5552 bytes between reductions
+        for (size_t i = 0; i < run;) {
+          size_t end = run - i < 5552 ? run : i + 5552;
+          for (; i < end; ++i) {
+            a += src[i];
+            b += a;
+          }
+          a %= 65521;
+          b %= 65521;
+        }
+        
+        x += run;
+        left -= run;
+        if (x == stride) {
+          x = 0;
+          y++;
+        }
+      }
+      offset += n;
+    }
+    
+    unsigned int adler = (b << 16) | a;
+    unsigned char checksum[4] = {adler >> 24, adler >> 16, adler >> 8, adler};
+    _pngWrite(file, &crc, checksum, 4);
+    _pngEnd(file, crc);
+    
+    _pngChunk(file, &crc, "IEND", 0);
+    _pngEnd(file, crc);
+  }
+  
+  static void _captureSave(const CaptureSlot *slot) {
+    char path[512];
+    snprintf(path, sizeof(path), capture.pattern, slot->frame);
+    
+    FILE *file = fopen(path, "wb");
+    if (!file) { return; }
+    
+    // GL reads rows bottom up
+    int w = capture.w, h = capture.h;
+    const unsigned char **rows = malloc(h * sizeof(*rows));
+    if (!rows) { exit(-1); }
+    for (int y = 0; y < h; ++y) {
+      #ifdef MINI_BACKEND_SOFTWARE
+        rows[y] = slot->pixels + (size_t)y * w * 4;
+      #else
+        rows[y] = slot->pixels + (size_t)(h - 1 - y) * w * 4;
+      #endif
+    }
+    
+    if (capture.format == CAPTURE_PNG) {
+      _pngSave(file, rows, w, h);
+    } else if (capture.format == CAPTURE_PPM) {
+      fprintf(file, "P6\n%d %d\n255\n", w, h);
+      unsigned char *rgb = malloc((size_t)w * 3);
+      if (!rgb) { exit(-1); }
+      for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) { memcpy(rgb + x * 3, rows[y] + x * 4, 3); }
+        fwrite(rgb, 1, (size_t)w * 3, file);
+      }
+      free(rgb);
+    } else {
+      for (int y = 0; y < h; ++y) { fwrite(rows[y], 1, (size_t)w * 4, file); }
+    }
+    
+    free(rows);
+    fclose(file);
+  }
+  
+  // --- WRITER --- //
+  // Takes slots in the order they were filled until told to finish and
+  // nothing is left
+  #ifdef _WIN32
+    static DWORD WINAPI _captureWriter(LPVOID unused) {
+  #else
+    static void *_captureWriter(void *unused) {
+  #endif
+    (void)unused;
+    int slot = 0;
+    
+    for (;;) {
+      CaptureSlot *s = &capture.slots[slot];
+      if (atomic_load(&s->ready)) {
+        _captureSave(s);
+        atomic_store(&s->ready, 0);
+        atomic_fetch_add(&capture.written, 1);
+        slot = (slot + 1) % MINI_CAPTURE_SLOTS;
+      } else if (atomic_load(&capture.finished)) {
+        break;
+      } else {
+        _sleep(0.001);
+      }
+    }
+    return 0;
+  }
+  
+  // --- CAPTURE --- //
+  static void _captureHandOff(const unsigned char *pixels, int frame) {
+    CaptureSlot *slot = &capture.slots[capture.slot];
+    if (atomic_load(&slot->ready)) {
+      capture.stats.dropped++;
+      return;
+    }
+    
+    memcpy(slot->pixels, pixels, (size_t)capture.w * capture.h * 4);
+    slot->frame = frame;
+    atomic_store(&slot->ready, 1);
+    capture.slot = (capture.slot + 1) % MINI_CAPTURE_SLOTS;
+  }
+  
+  void captureStop() {
+    if (!capture.running) { return; }
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      // Frames still in flight are worth the stall on the way out
+      for (int i = 0; i < MINI_CAPTURE_PBOS; ++i) {
+        int pbo = (capture.pbo + i) % MINI_CAPTURE_PBOS;
+        if (capture.pending[pbo] < 0) { continue; }
+        
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbos[pbo]);
+        const unsigned char *pixels = _glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+          _captureHandOff(pixels, capture.pending[pbo]);
+          _glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        capture.pending[pbo] = -1;
+      }
+      
+      if (capture.pbos[0]) {
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        _glDeleteBuffers(MINI_CAPTURE_PBOS, capture.pbos);
+      }
+    #endif
+    
+    atomic_store(&capture.finished, 1);
+    #ifdef _WIN32
+      WaitForSingleObject(capture.thread, INFINITE);
+      CloseHandle(capture.thread);
+    #else
+      pthread_join(capture.thread, NULL);
+    #endif
+    
+    for (int i = 0; i < MINI_CAPTURE_SLOTS; ++i) {
+      free(capture.slots[i].pixels);
+    }
+    
+    capture.stats.written = atomic_load(&capture.written);
+    CaptureStats stats = capture.stats;
+    memset(&capture, 0, sizeof(capture));
+    capture.stats = stats;
+  }
+  
+  int captureStart(const char *pattern, CaptureFormat format, int frames) {
+    captureStop();
+    memset(&capture, 0, sizeof(capture));
+    
+    snprintf(capture.pattern, sizeof(capture.pattern), "%s", pattern);
+    capture.format = format;
+    capture.limit = frames;
+    capture.w = mini_window.w;
+    capture.h = mini_window.h;
+    
+    size_t size = (size_t)capture.w * capture.h * 4;
+    for (int i = 0; i < MINI_CAPTURE_SLOTS; ++i) {
+      capture.slots[i].pixels = malloc(size);
+      if (!capture.slots[i].pixels) { exit(-1); }
+    }
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      for (int i = 0; i < MINI_CAPTURE_PBOS; ++i) { capture.pending[i] = -1; }
+      
+      if (_glGenBuffers) {
+        _glGenBuffers(MINI_CAPTURE_PBOS, capture.pbos);
+        for (int i = 0; i < MINI_CAPTURE_PBOS; ++i) {
+          _glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbos[i]);
+          _glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        }
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      }
+    #endif
+    
+    #ifdef _WIN32
+      capture.thread = CreateThread(NULL, 0, _captureWriter, NULL, 0, NULL);
+      int started = capture.thread != NULL;
+    #else
+      int started = pthread_create(&capture.thread, NULL, _captureWriter, NULL) == 0;
+    #endif
+    if (!started) {
+      for (int i = 0; i < MINI_CAPTURE_SLOTS; ++i) { free(capture.slots[i].pixels); }
+      memset(&capture, 0, sizeof(capture));
+      return 0;
+    }
+    
+    capture.running = 1;
+    capture.active = 1;
+    return 1;
+  }
+  
+  CaptureStats captureStats() {
+    CaptureStats stats = capture.stats;
+    if (capture.running) { stats.written = atomic_load(&capture.written); }
+    return stats;
+  }
+  
+  // Called by windowUpdate with the finished frame still in the back buffer
+  void _captureFrame() {
+    if (!capture.running) { return; }
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      // The oldest buffer is collected before it is reused, and the ring
+      // keeps draining, one buffer a frame, after the last frame was read
+      int pbo = capture.pbo;
+      if (capture.pbos[0] && capture.pending[pbo] >= 0) {
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbos[pbo]);
+        const unsigned char *pixels = _glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (pixels) {
+          _captureHandOff(pixels, capture.pending[pbo]);
+          _glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        capture.pending[pbo] = -1;
+      }
+    #endif
+    
+    if (!capture.active) {
+      #ifndef MINI_BACKEND_SOFTWARE
+        capture.pbo = (pbo + 1) % MINI_CAPTURE_PBOS;
+        for (int i = 0; i < MINI_CAPTURE_PBOS; ++i) {
+          if (capture.pending[i] >= 0) { return; }
+        }
+      #endif
+      // Nothing is in flight, so the writer exits once its slots are saved
+      atomic_store(&capture.finished, 1);
+      return;
+    }
+    
+    // Slots are sized for the window the capture started with
+    if (mini_window.w != capture.w || mini_window.h != capture.h) {
+      capture.stats.dropped++;
+      return;
+    }
+    
+    int frame = capture.frame++;
+    capture.stats.captured++;
+    if (capture.limit && capture.frame >= capture.limit) { capture.active = 0; }
+    
+    #ifdef MINI_BACKEND_SOFTWARE
+      _captureHandOff((const unsigned char *)framebuffer.pixels, frame);
+    #else
+      if (capture.pbos[0]) {
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbos[pbo]);
+        glReadPixels(0, 0, capture.w, capture.h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        _glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        capture.pending[pbo] = frame;
+        capture.pbo = (pbo + 1) % MINI_CAPTURE_PBOS;
+      } else {
+        // Without pixel buffers the read is synchronous
+        unsigned char *pixels = frameAlloc((size_t)capture.w * capture.h * 4);
+        glReadPixels(0, 0, capture.w, capture.h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        _captureHandOff(pixels, frame);
+      }
+    #endif
+  }
+#endif
@@ -105,7 +105,46 @@ Vec2 measureText(const char *text, float scale);
 #endif // MINIFONTS_H
 
 #ifdef MINI_IMPLEMENTATION
+  // Glyphs are packed 16 per row into one texture, so a character is a
+  // single textured quad and a whole string is drawn in one flush.
+  #define FONT_GLYPHS (sizeof(font8x8_basic) / sizeof(font8x8_basic[0]))
+  #define FONT_ATLAS_W 128
+  #define FONT_ATLAS_H 64
+  
+  unsigned int font_atlas;
+  
+  void _fontsInit() {
+    static unsigned char pixels[FONT_ATLAS_W * FONT_ATLAS_H * 4];
+    
+    for (int c = 0; c < (int)FONT_GLYPHS; ++c) {
+      int gx = (c % 16) * 8;
+      int gy = (c / 16) * 8;
+      
+      for (int yy = 0; yy < 8; ++yy) {
+        for (int xx = 0; xx < 8; ++xx) {
+          unsigned char *p = &pixels[((gy + yy) * FONT_ATLAS_W + gx + xx) * 4];
+          p[0] = p[1] = p[2] = 0xFF;
+          p[3] = font8x8_basic[c][yy] & 1 << xx ? 0xFF : 0x00;
+        }
+      }
+    }
+    
+    font_atlas = _textureCreate(FONT_ATLAS_W, FONT_ATLAS_H, pixels);
+  }
+  
   void drawText(const char *text, float x, float y, float scale, Color color) {
+    TRACE_SHAPE_DATA(TRACE_OP_TEXT, 0, color, text, strlen(text) + 1, x, y, scale);
+    
+    // Text extends right and down from its origin, so that check is free
+    if (x > view.x + view.w || y > view.y + view.h) {
+      _visible(x, y, x, y);
+      return;
+    }
+    
+    Vec2 size = measureText(text, scale);
+    if (!_visible(x, y, x + size.x, y + size.y)) { return; }
+    PICK_RECT(x, y, x + size.x, y + size.y);
+    
     int startx = x;
     int starty = y;
     int newlines = 0;
@@ -119,15 +158,13 @@ Vec2 measureText(const char *text, float scale);
         x = startx;
         y = starty + ((newlines * (8 + spacing)) * scale);
       } else {
-        char *character = font8x8_basic[c - ' '];
-      
-        for (int yy = 0; yy < 8; ++yy) {
-          for (int xx = 0; xx < 8; ++xx) {
-            if (character[yy] & 1 << xx) {
-              drawRectangleFilled(x + (xx * scale), y + (yy * scale), scale, scale, color);
-            }
-          }
-        } 
+        int glyph = c - ' ';
+        
+        if (glyph > 0 && glyph < (int)FONT_GLYPHS) {
+          float u = (glyph % 16) * 8.0f / FONT_ATLAS_W;
+          float v = (glyph / 16) * 8.0f / FONT_ATLAS_H;
+          _batchQuad(font_atlas, x, y, 8 * scale, 8 * scale, u, v, u + 8.0f / FONT_ATLAS_W, v + 8.0f / FONT_ATLAS_H, color);
+        }
         x += 8 * scale;
       }
     }
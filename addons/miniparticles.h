@@ -0,0 +1,217 @@
+#ifndef MINIPARTICLES_H
+#define MINIPARTICLES_H
+
+typedef enum { PARTICLE_SQUARE, PARTICLE_CIRCLE } ParticleShape;
+
+// Structure of arrays, every array aligned to 16 bytes and sized to a
+// multiple of 4. size is the width of a square or the radius of a circle;
+// life counts down in seconds and a particle dies when it runs out.
+// gravity is an acceleration in pixels per second squared and drag the
+// fraction of velocity lost per second.
+typedef struct {
+  float *x;
+  float *y;
+  float *vx;
+  float *vy;
+  float *life;
+  float *size;
+  Color *color;
+  int count;
+  int capacity;
+  float gravity_x;
+  float gravity_y;
+  float drag;
+  ParticleShape shape;
+  void *memory;
+} Particles;
+
+// All memory is allocated here; particleEmit returns 0 when full
+int particlesInit(Particles *particles, int capacity);
+int particleEmit(Particles *particles, float x, float y, float vx, float vy, float life, float size, Color color);
+void particlesUpdate(Particles *particles, float dt);
+void drawParticles(const Particles *particles);
+void particlesFree(Particles *particles);
+
+#endif // MINIPARTICLES_H
+
+#ifdef MINI_IMPLEMENTATION
+  // Updates make two passes over the arrays: integrate and age four
+  // particles per instruction, then kill by moving the last live particle
+  // into each dead slot, skipping four at a time while none died. Killing
+  // reorders particles but never allocates. Drawing expands the arrays
+  // into frame memory and submits them as one instanced draw.
+  #if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define MINI_PARTICLES_SSE
+  #endif
+  
+  int particlesInit(Particles *particles, int capacity) {
+    *particles = (Particles){0};
+    if (capacity <= 0) { return 0; }
+    
+    size_t stride = ((size_t)capacity + 3) & ~(size_t)3;
+    unsigned char *memory = malloc(stride * (6 * sizeof(float) + sizeof(Color)) + 16);
+    if (!memory) { exit(-1); }
+    
+    float *base = (float *)(((size_t)memory + 15) & ~(size_t)15);
+    particles->x = base;
+    particles->y = base + stride;
+    particles->vx = base + stride * 2;
+    particles->vy = base + stride * 3;
+    particles->life = base + stride * 4;
+    particles->size = base + stride * 5;
+    particles->color = (Color *)(base + stride * 6);
+    particles->capacity = capacity;
+    particles->memory = memory;
+    return 1;
+  }
+  
+  int particleEmit(Particles *particles, float x, float y, float vx, float vy, float life, float size, Color color) {
+    if (particles->count == particles->capacity || life <= 0.0f) { return 0; }
+    
+    int i = particles->count++;
+    particles->x[i] = x;
+    particles->y[i] = y;
+    particles->vx[i] = vx;
+    particles->vy[i] = vy;
+    particles->life[i] = life;
+    particles->size[i] = size;
+    particles->color[i] = color;
+    return 1;
+  }
+  
+  static void _particlesIntegrate(Particles *particles, float dt) {
+    float *restrict x = particles->x;
+    float *restrict y = particles->y;
+    float *restrict vx = particles->vx;
+    float *restrict vy = particles->vy;
+    float *restrict life = particles->life;
+    
+    float keep = fmaxf(0.0f, 1.0f - particles->drag * dt);
+    float gx = particles->gravity_x * dt;
+    float gy = particles->gravity_y * dt;
+    int n = particles->count;
+    int i = 0;
+    
+    #ifdef MINI_PARTICLES_SSE
+      __m128 keep4 = _mm_set1_ps(keep);
+      __m128 gx4 = _mm_set1_ps(gx);
+      __m128 gy4 = _mm_set1_ps(gy);
+      __m128 dt4 = _mm_set1_ps(dt);
+      
+      for (; i + 4 <= n; i += 4) {
+        __m128 vx4 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(vx + i), keep4), gx4);
+        __m128 vy4 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(vy + i), keep4), gy4);
+        _mm_store_ps(vx + i, vx4);
+        _mm_store_ps(vy + i, vy4);
+        _mm_store_ps(x + i, _mm_add_ps(_mm_load_ps(x + i), _mm_mul_ps(vx4, dt4)));
+        _mm_store_ps(y + i, _mm_add_ps(_mm_load_ps(y + i), _mm_mul_ps(vy4, dt4)));
+        _mm_store_ps(life + i, _mm_sub_ps(_mm_load_ps(life + i), dt4));
+      }
+    #endif
+    
+    for (; i < n; ++i) {
+      vx[i] = vx[i] * keep + gx;
+      vy[i] = vy[i] * keep + gy;
+      x[i] += vx[i] * dt;
+      y[i] += vy[i] * dt;
+      life[i] -= dt;
+    }
+  }
+  
+  static void _particlesKill(Particles *particles) {
+    const float *life = particles->life;
+    int n = particles->count;
+    int i = 0;
+    
+    #ifdef MINI_PARTICLES_SSE
+      __m128 zero = _mm_setzero_ps();
+    #endif
+    
+    while (i < n) {
+      #ifdef MINI_PARTICLES_SSE
+        if (i + 4 <= n && !_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(life + i), zero))) {
+          i += 4;
+          continue;
+        }
+      #endif
+      
+      if (life[i] > 0.0f) {
+        i++;
+        continue;
+      }
+      
+      // The moved particle is checked again on the next pass of the loop
+      n--;
+      particles->x[i] = particles->x[n];
+      particles->y[i] = particles->y[n];
+      particles->vx[i] = particles->vx[n];
+      particles->vy[i] = particles->vy[n];
+      particles->life[i] = particles->life[n];
+      particles->size[i] = particles->size[n];
+      particles->color[i] = particles->color[n];
+    }
+    
+    particles->count = n;
+  }
+  
+  void particlesUpdate(Particles *particles, float dt) {
+    _particlesIntegrate(particles, dt);
+    _particlesKill(particles);
+  }
+  
+  // Main thread only, the shapes live in the frame arena
+  void drawParticles(const Particles *particles) {
+    int n = particles->count;
+    if (n == 0) { return; }
+    
+    const float *x = particles->x;
+    const float *y = particles->y;
+    const float *size = particles->size;
+    
+    if (particles->shape == PARTICLE_CIRCLE) {
+      float *xyr = frameAlloc(n * 3 * sizeof(float));
+      for (int i = 0; i < n; ++i) {
+        xyr[i*3] = x[i];
+        xyr[i*3+1] = y[i];
+        xyr[i*3+2] = size[i];
+      }
+      drawCirclesFilled(xyr, particles->color, n);
+      return;
+    }
+    
+    // Squares are centred on their position
+    float *xywh = frameAlloc(n * 4 * sizeof(float));
+    int i = 0;
+    
+    #ifdef MINI_PARTICLES_SSE
+      __m128 half = _mm_set1_ps(0.5f);
+      for (; i + 4 <= n; i += 4) {
+        __m128 s = _mm_load_ps(size + i);
+        __m128 h = _mm_mul_ps(s, half);
+        __m128 r0 = _mm_sub_ps(_mm_load_ps(x + i), h);
+        __m128 r1 = _mm_sub_ps(_mm_load_ps(y + i), h);
+        __m128 r2 = s;
+        __m128 r3 = s;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_store_ps(xywh + i*4, r0);
+        _mm_store_ps(xywh + i*4 + 4, r1);
+        _mm_store_ps(xywh + i*4 + 8, r2);
+        _mm_store_ps(xywh + i*4 + 12, r3);
+      }
+    #endif
+    
+    for (; i < n; ++i) {
+      xywh[i*4] = x[i] - size[i] * 0.5f;
+      xywh[i*4+1] = y[i] - size[i] * 0.5f;
+      xywh[i*4+2] = size[i];
+      xywh[i*4+3] = size[i];
+    }
+    drawRectanglesFilled(xywh, particles->color, n);
+  }
+  
+  void particlesFree(Particles *particles) {
+    free(particles->memory);
+    *particles = (Particles){0};
+  }
+#endif // MINI_IMPLEMENTATION
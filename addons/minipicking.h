@@ -0,0 +1,205 @@
+#ifndef MINIPICKING_H
+#define MINIPICKING_H
+
+// Shapes drawn while an id other than 0 is set are remembered for the rest
+// of the frame: rectangles, sprites, text boxes, triangles, polygons,
+// circles, slices and arcs, outlined or filled. pickAt returns the id of
+// the topmost one under a point, or 0.
+void pickId(int id);
+int pickAt(float x, float y);
+
+#endif // MINIPICKING_H
+
+#ifdef MINI_IMPLEMENTATION
+  // Shapes are appended to a list in frame memory. The first pickAt after
+  // new shapes were drawn sorts them into a uniform grid over the window by
+  // counting, then filling, the cells each one's bounds cover, so building
+  // is linear. A query scans one cell from the last drawn shape backwards
+  // and tests the exact outline only for shapes whose bounds hold the
+  // point. With MINI_QUEUE a hit only gives way to one at a higher depth.
+  // Everything is dropped by windowUpdate; shapes recorded into command
+  // lists and instanced arrays are not picked.
+  #ifndef MINI_PICK_CELL
+    #define MINI_PICK_CELL 32
+  #endif
+  
+  typedef enum { PICK_KIND_RECT, PICK_KIND_SECTOR, PICK_KIND_POLYGON } PickKind;
+  
+  // Sectors keep their centre, radii and start and sweep in degrees
+  typedef struct {
+    int id;
+    PickKind kind;
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+    float params[6];
+    const float *points;
+    int count;
+    int depth;
+    int cells[4];
+  } PickShape;
+  
+  typedef struct {
+    int id;
+    PickShape *shapes;
+    int count;
+    int capacity;
+    int built;
+    int grid_w;
+    int grid_h;
+    int *start;
+    int *entries;
+  } Picking;
+  
+  Picking pick;
+  
+  #define PICK_RECT(x0, y0, x1, y1) do { if (pick.id && !recording) { _pickAdd(PICK_KIND_RECT, x0, y0, x1, y1, NULL, NULL, 0); } } while (0)
+  #define PICK_POLYGON(points, count) do { if (pick.id && !recording) { _pickPolygon(points, count); } } while (0)
+  #define PICK_SECTOR(x, y, inner, outer, start, end) do { if (pick.id && !recording) { _pickSector(x, y, inner, outer, start, end); } } while (0)
+  #define PICK_FRAME() (pick = (Picking){.id = pick.id})
+  
+  void pickId(int id) {
+    pick.id = id;
+  }
+  
+  static PickShape *_pickAdd(PickKind kind, float x0, float y0, float x1, float y1, const float *params, const float *points, int count) {
+    // Grows by doubling inside the arena, so the copies add up to at most
+    // as much again as the final list
+    if (pick.count == pick.capacity) {
+      int capacity = pick.capacity ? pick.capacity * 2 : 256;
+      PickShape *shapes = frameAlloc(capacity * sizeof(PickShape));
+      if (pick.count) { memcpy(shapes, pick.shapes, pick.count * sizeof(PickShape)); }
+      pick.shapes = shapes;
+      pick.capacity = capacity;
+    }
+    
+    PickShape *shape = &pick.shapes[pick.count++];
+    *shape = (PickShape){.id = pick.id, .kind = kind, .x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1};
+    if (params) { memcpy(shape->params, params, sizeof(shape->params)); }
+    shape->points = points;
+    shape->count = count;
+    #ifdef MINI_QUEUE
+      shape->depth = queue.depth;
+    #endif
+    return shape;
+  }
+  
+  static void _pickPolygon(const float *points, int count) {
+    int n = count / 2;
+    if (n < 3) { return; }
+    
+    float *copy = frameAlloc(n * 2 * sizeof(float));
+    memcpy(copy, points, n * 2 * sizeof(float));
+    
+    float x0 = points[0], y0 = points[1], x1 = points[0], y1 = points[1];
+    for (int i = 1; i < n; ++i) {
+      x0 = fminf(x0, points[i*2]);
+      y0 = fminf(y0, points[i*2+1]);
+      x1 = fmaxf(x1, points[i*2]);
+      y1 = fmaxf(y1, points[i*2+1]);
+    }
+    _pickAdd(PICK_KIND_POLYGON, x0, y0, x1, y1, NULL, copy, n);
+  }
+  
+  static void _pickSector(float x, float y, float inner, float outer, float start, float end) {
+    if (end < start) {
+      float swap = start;
+      start = end;
+      end = swap;
+    }
+    float params[6] = {x, y, inner, outer, start, end - start};
+    _pickAdd(PICK_KIND_SECTOR, x - outer, y - outer, x + outer, y + outer, params, NULL, 0);
+  }
+  
+  static int _pickHit(const PickShape *shape, float x, float y) {
+    if (x < shape->x0 || y < shape->y0 || x > shape->x1 || y > shape->y1) { return 0; }
+    
+    if (shape->kind == PICK_KIND_SECTOR) {
+      const float *p = shape->params;
+      float dx = x - p[0];
+      float dy = y - p[1];
+      float d2 = dx * dx + dy * dy;
+      if (d2 > p[3] * p[3] || d2 < p[2] * p[2]) { return 0; }
+      if (p[5] >= 360.0f) { return 1; }
+      
+      // Angles run from +y towards +x, as the shapes are drawn
+      float angle = atan2f(dx, dy) * (float)(180.0 / PI) - p[4];
+      angle -= floorf(angle / 360.0f) * 360.0f;
+      return angle <= p[5];
+    }
+    
+    if (shape->kind == PICK_KIND_POLYGON) {
+      // Even-odd rule, like the crossings of a horizontal ray
+      const float *pt = shape->points;
+      int inside = 0;
+      for (int i = 0, j = shape->count - 1; i < shape->count; j = i++) {
+        float xi = pt[i*2], yi = pt[i*2+1], xj = pt[j*2], yj = pt[j*2+1];
+        if ((yi > y) != (yj > y) && x < xj + (y - yj) * (xi - xj) / (yi - yj)) { inside = !inside; }
+      }
+      return inside;
+    }
+    
+    return 1;
+  }
+  
+  static int _pickCell(float v, int cells) {
+    int c = (int)floorf(v / MINI_PICK_CELL);
+    return c < 0 ? 0 : c >= cells ? cells - 1 : c;
+  }
+  
+  static void _pickBuild() {
+    pick.grid_w = (mini_window.w + MINI_PICK_CELL - 1) / MINI_PICK_CELL;
+    pick.grid_h = (mini_window.h + MINI_PICK_CELL - 1) / MINI_PICK_CELL;
+    if (pick.grid_w < 1) { pick.grid_w = 1; }
+    if (pick.grid_h < 1) { pick.grid_h = 1; }
+    
+    int cells = pick.grid_w * pick.grid_h;
+    pick.start = frameAlloc((cells + 1) * sizeof(int));
+    memset(pick.start, 0, (cells + 1) * sizeof(int));
+    
+    // Count the entries per cell, offset by one for the prefix sum
+    for (int i = 0; i < pick.count; ++i) {
+      PickShape *shape = &pick.shapes[i];
+      int *c = shape->cells;
+      c[0] = _pickCell(shape->x0, pick.grid_w);
+      c[1] = _pickCell(shape->y0, pick.grid_h);
+      c[2] = _pickCell(shape->x1, pick.grid_w);
+      c[3] = _pickCell(shape->y1, pick.grid_h);
+      
+      for (int y = c[1]; y <= c[3]; ++y) {
+        for (int x = c[0]; x <= c[2]; ++x) { pick.start[y * pick.grid_w + x + 1]++; }
+      }
+    }
+    
+    for (int i = 0; i < cells; ++i) { pick.start[i + 1] += pick.start[i]; }
+    
+    // Filled in drawing order, so each cell lists its shapes bottom to top
+    int *fill = frameAlloc(cells * sizeof(int));
+    memcpy(fill, pick.start, cells * sizeof(int));
+    pick.entries = frameAlloc((pick.start[cells] ? pick.start[cells] : 1) * sizeof(int));
+    
+    for (int i = 0; i < pick.count; ++i) {
+      const int *c = pick.shapes[i].cells;
+      for (int y = c[1]; y <= c[3]; ++y) {
+        for (int x = c[0]; x <= c[2]; ++x) { pick.entries[fill[y * pick.grid_w + x]++] = i; }
+      }
+    }
+    
+    pick.built = pick.count;
+  }
+  
+  int pickAt(float x, float y) {
+    if (pick.count == 0) { return 0; }
+    if (pick.built != pick.count) { _pickBuild(); }
+    
+    int cell = _pickCell(y, pick.grid_h) * pick.grid_w + _pickCell(x, pick.grid_w);
+    const PickShape *top = NULL;
+    for (int i = pick.start[cell + 1] - 1; i >= pick.start[cell]; --i) {
+      const PickShape *shape = &pick.shapes[pick.entries[i]];
+      if (top && shape->depth <= top->depth) { continue; }
+      if (_pickHit(shape, x, y)) { top = shape; }
+    }
+    return top ? top->id : 0;
+  }
+#endif // MINI_IMPLEMENTATION
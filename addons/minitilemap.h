@@ -0,0 +1,259 @@
+#ifndef MINITILEMAP_H
+#define MINITILEMAP_H
+
+// Triangles of one chunk, relative to the map's origin. On GL they live
+// in a static vertex buffer and vertices stays NULL.
+typedef struct {
+  Vertex *vertices;
+  int count;
+  unsigned int buffer;
+  int dirty;
+} TilemapChunk;
+
+// Grid of w * h colored cells, each cell pixels square. Cells with zero
+// alpha are empty.
+typedef struct {
+  Color *cells;
+  TilemapChunk *chunks;
+  int w;
+  int h;
+  int chunks_x;
+  int chunks_y;
+  float cell;
+} Tilemap;
+
+int tilemapInit(Tilemap *map, int w, int h, float cell);
+void tilemapSet(Tilemap *map, int x, int y, Color color);
+Color tilemapGet(const Tilemap *map, int x, int y);
+void drawTilemap(Tilemap *map, float x, float y);
+void tilemapFree(Tilemap *map);
+
+#endif // MINITILEMAP_H
+
+#ifdef MINI_IMPLEMENTATION
+  // The grid is split into square chunks of MINI_TILEMAP_CHUNK cells. A
+  // chunk's triangles are built once, with each run of equal cells in a
+  // row merged into one quad, and only rebuilt when it is drawn after one
+  // of its cells changed. Drawing visits just the chunks overlapping the
+  // view, so its cost follows the screen rather than the map.
+  #ifndef MINI_TILEMAP_CHUNK
+    #define MINI_TILEMAP_CHUNK 32
+  #endif
+  
+  #define TILEMAP_VERTICES (MINI_TILEMAP_CHUNK * MINI_TILEMAP_CHUNK * 6)
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    #ifndef GL_ARRAY_BUFFER
+      #define GL_ARRAY_BUFFER 0x8892
+      #define GL_STATIC_DRAW  0x88E4
+    #endif
+    
+    TilemapChunk **tilemap_list;
+    int tilemap_count;
+    float tilemap_x;
+    float tilemap_y;
+  #endif
+  
+  int tilemapInit(Tilemap *map, int w, int h, float cell) {
+    *map = (Tilemap){0};
+    if (w <= 0 || h <= 0 || cell <= 0.0f) { return 0; }
+    
+    map->w = w;
+    map->h = h;
+    map->cell = cell;
+    map->chunks_x = (w + MINI_TILEMAP_CHUNK - 1) / MINI_TILEMAP_CHUNK;
+    map->chunks_y = (h + MINI_TILEMAP_CHUNK - 1) / MINI_TILEMAP_CHUNK;
+    map->cells = calloc((size_t)w * h, sizeof(Color));
+    map->chunks = calloc((size_t)map->chunks_x * map->chunks_y, sizeof(TilemapChunk));
+    if (!map->cells || !map->chunks) { exit(-1); }
+    return 1;
+  }
+  
+  static inline int _colorEqual(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+  }
+  
+  void tilemapSet(Tilemap *map, int x, int y, Color color) {
+    if (x < 0 || y < 0 || x >= map->w || y >= map->h) { return; }
+    
+    Color *cell = &map->cells[(size_t)y * map->w + x];
+    if (_colorEqual(*cell, color)) { return; }
+    
+    *cell = color;
+    map->chunks[(y / MINI_TILEMAP_CHUNK) * map->chunks_x + x / MINI_TILEMAP_CHUNK].dirty = 1;
+  }
+  
+  Color tilemapGet(const Tilemap *map, int x, int y) {
+    if (x < 0 || y < 0 || x >= map->w || y >= map->h) { return (Color){0}; }
+    return map->cells[(size_t)y * map->w + x];
+  }
+  
+  // Writes at most TILEMAP_VERTICES and returns how many
+  static int _tilemapBuild(const Tilemap *map, int cx, int cy, Vertex *out) {
+    int x0 = cx * MINI_TILEMAP_CHUNK;
+    int y0 = cy * MINI_TILEMAP_CHUNK;
+    int x1 = x0 + MINI_TILEMAP_CHUNK < map->w ? x0 + MINI_TILEMAP_CHUNK : map->w;
+    int y1 = y0 + MINI_TILEMAP_CHUNK < map->h ? y0 + MINI_TILEMAP_CHUNK : map->h;
+    float s = map->cell;
+    int count = 0;
+    
+    for (int y = y0; y < y1; ++y) {
+      const Color *row = map->cells + (size_t)y * map->w;
+      
+      for (int x = x0; x < x1;) {
+        Color color = row[x];
+        int end = x + 1;
+        while (end < x1 && _colorEqual(row[end], color)) { end++; }
+        
+        if (color.a) {
+          float left = x * s, right = end * s, top = y * s, bottom = (y + 1) * s;
+          Vertex *v = out + count;
+          v[0] = (Vertex){left, top, 0.0f, 0.0f, color};
+          v[1] = (Vertex){right, top, 0.0f, 0.0f, color};
+          v[2] = (Vertex){right, bottom, 0.0f, 0.0f, color};
+          v[3] = (Vertex){left, top, 0.0f, 0.0f, color};
+          v[4] = (Vertex){right, bottom, 0.0f, 0.0f, color};
+          v[5] = (Vertex){left, bottom, 0.0f, 0.0f, color};
+          count += 6;
+        }
+        x = end;
+      }
+    }
+    return count;
+  }
+  
+  static void _tilemapRebuild(Tilemap *map, TilemapChunk *chunk, int cx, int cy) {
+    Vertex *scratch = frameAlloc(TILEMAP_VERTICES * sizeof(Vertex));
+    chunk->count = _tilemapBuild(map, cx, cy, scratch);
+    chunk->dirty = 0;
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      if (_glBufferData) {
+        if (!chunk->buffer) { _glGenBuffers(1, &chunk->buffer); }
+        _glBindBuffer(GL_ARRAY_BUFFER, chunk->buffer);
+        _glBufferData(GL_ARRAY_BUFFER, chunk->count * sizeof(Vertex), scratch, GL_STATIC_DRAW);
+        _glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+      }
+    #endif
+    
+    chunk->vertices = realloc(chunk->vertices, (chunk->count ? chunk->count : 1) * sizeof(Vertex));
+    if (!chunk->vertices) { exit(-1); }
+    memcpy(chunk->vertices, scratch, chunk->count * sizeof(Vertex));
+  }
+  
+  // Copies prebuilt triangles into the batch, moved to the map's position
+  static void _tilemapSubmit(const Vertex *vertices, int count, float x, float y) {
+    const int chunk = MINI_BATCH_CAPACITY / 6 * 6;
+    
+    for (int done = 0; done < count; done += chunk) {
+      int n = count - done < chunk ? count - done : chunk;
+      Vertex *v = _batchBegin(GL_TRIANGLES, 0, n);
+      for (int i = 0; i < n; ++i) {
+        v[i] = vertices[done + i];
+        v[i].x += x;
+        v[i].y += y;
+      }
+    }
+  }
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    static void _tilemapDraw() {
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix();
+      glTranslatef(tilemap_x, tilemap_y, 0.0f);
+      
+      for (int i = 0; i < tilemap_count; ++i) {
+        _glBindBuffer(GL_ARRAY_BUFFER, tilemap_list[i]->buffer);
+        glVertexPointer(2, GL_FLOAT, sizeof(Vertex), (const void *)offsetof(Vertex, x));
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const void *)offsetof(Vertex, color));
+        glDrawArrays(GL_TRIANGLES, 0, tilemap_list[i]->count);
+      }
+      
+      _glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glPopMatrix();
+    }
+  #endif
+  
+  void drawTilemap(Tilemap *map, float x, float y) {
+    float size = map->cell * MINI_TILEMAP_CHUNK;
+    
+    int cx0 = (int)floorf((view.x - x) / size);
+    int cy0 = (int)floorf((view.y - y) / size);
+    int cx1 = (int)floorf((view.x + view.w - x) / size);
+    int cy1 = (int)floorf((view.y + view.h - y) / size);
+    cx0 = cx0 < 0 ? 0 : cx0;
+    cy0 = cy0 < 0 ? 0 : cy0;
+    cx1 = cx1 >= map->chunks_x ? map->chunks_x - 1 : cx1;
+    cy1 = cy1 >= map->chunks_y ? map->chunks_y - 1 : cy1;
+    if (cx0 > cx1 || cy0 > cy1) { return; }
+    
+    // Recording threads can neither upload nor use the frame arena, so
+    // they rebuild what they draw into their own scratch memory
+    if (recording) {
+      Vertex *scratch = malloc(TILEMAP_VERTICES * sizeof(Vertex));
+      if (!scratch) { exit(-1); }
+      
+      for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+          if (!_visible(x + cx * size, y + cy * size, x + (cx + 1) * size, y + (cy + 1) * size)) { continue; }
+          _tilemapSubmit(scratch, _tilemapBuild(map, cx, cy, scratch), x, y);
+        }
+      }
+      free(scratch);
+      return;
+    }
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      tilemap_list = frameAlloc((cx1 - cx0 + 1) * (cy1 - cy0 + 1) * sizeof(TilemapChunk *));
+      tilemap_count = 0;
+    #endif
+    
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        if (!_visible(x + cx * size, y + cy * size, x + (cx + 1) * size, y + (cy + 1) * size)) { continue; }
+        
+        TilemapChunk *chunk = &map->chunks[cy * map->chunks_x + cx];
+        if (chunk->dirty) { _tilemapRebuild(map, chunk, cx, cy); }
+        if (!chunk->count) { continue; }
+        
+        #ifndef MINI_BACKEND_SOFTWARE
+          if (chunk->buffer) {
+            tilemap_list[tilemap_count++] = chunk;
+            continue;
+          }
+        #endif
+        _tilemapSubmit(chunk->vertices, chunk->count, x, y);
+      }
+    }
+    
+    #ifndef MINI_BACKEND_SOFTWARE
+      if (tilemap_count) {
+        batchFlush();
+        tilemap_x = x;
+        tilemap_y = y;
+        
+        PROFILE_BEGIN(PROFILE_FLUSH);
+        _drawClipped(_tilemapDraw);
+        PROFILE_END(PROFILE_FLUSH);
+        
+        for (int i = 0; i < tilemap_count; ++i) {
+          batch.frame.vertices += tilemap_list[i]->count;
+        }
+        batch.frame.flushes += tilemap_count;
+      }
+    #endif
+  }
+  
+  void tilemapFree(Tilemap *map) {
+    for (int i = 0; i < map->chunks_x * map->chunks_y; ++i) {
+      #ifndef MINI_BACKEND_SOFTWARE
+        if (map->chunks[i].buffer) { _glDeleteBuffers(1, &map->chunks[i].buffer); }
+      #endif
+      free(map->chunks[i].vertices);
+    }
+    free(map->chunks);
+    free(map->cells);
+    *map = (Tilemap){0};
+  }
+#endif // MINI_IMPLEMENTATION
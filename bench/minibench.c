@@ -0,0 +1,188 @@
+// Primitive micro-benchmark
+//
+// Draws each public primitive at 1 to 100k shapes per frame and reports
+// ns/shape, vertices/frame and frames/sec. Built against the software
+// backend it runs headless; built against GLFW it measures the GL path.
+//
+//   minibench [--csv] [--frames N] [--max N] [--filter name]
+
+#define MINI_IMPLEMENTATION
+#define MINI_FONTS
+#include "../miniengine.h"
+
+#include <string.h>
+#include <time.h>
+
+#define WIDTH  640
+#define HEIGHT 480
+
+#ifdef MINI_BACKEND_SOFTWARE
+  #define BACKEND "software"
+#else
+  #define BACKEND "opengl"
+#endif
+
+typedef void (*Primitive)(int i, float x, float y, float s, Color color);
+
+typedef struct {
+  const char *name;
+  Primitive draw;
+} Benchmark;
+
+static float polygon[] = { 0, 0, 1, 0, 1.3f, 0.6f, 0.5f, 1, -0.3f, 0.6f };
+
+static void benchLine(int i, float x, float y, float s, Color c) { drawLine(x, y, x + s, y + s * 0.5f, c); }
+static void benchTriangle(int i, float x, float y, float s, Color c) { drawTriangle(x, y, x + s, y, x, y + s, c); }
+static void benchTriangleFilled(int i, float x, float y, float s, Color c) { drawTriangleFilled(x, y, x + s, y, x, y + s, c); }
+static void benchRectangle(int i, float x, float y, float s, Color c) { drawRectangle(x, y, s, s, c); }
+static void benchRectangleFilled(int i, float x, float y, float s, Color c) { drawRectangleFilled(x, y, s, s, c); }
+static void benchCircle(int i, float x, float y, float s, Color c) { drawCircle(x, y, s * 0.5f, c); }
+static void benchCircleFilled(int i, float x, float y, float s, Color c) { drawCircleFilled(x, y, s * 0.5f, c); }
+static void benchSlice(int i, float x, float y, float s, Color c) { drawSlice(x, y, s * 0.5f, 30, 300, c); }
+static void benchSliceFilled(int i, float x, float y, float s, Color c) { drawSliceFilled(x, y, s * 0.5f, 30, 300, c); }
+static void benchArc(int i, float x, float y, float s, Color c) { drawArc(x, y, s * 0.3f, s * 0.2f, 30, 300, c); }
+static void benchArcFilled(int i, float x, float y, float s, Color c) { drawArcFilled(x, y, s * 0.3f, s * 0.2f, 30, 300, c); }
+
+static void benchPolygon(int i, float x, float y, float s, Color c) {
+  float points[10];
+  for (int k = 0; k < 10; k += 2) {
+    points[k] = x + polygon[k] * s;
+    points[k+1] = y + polygon[k+1] * s;
+  }
+  drawPolygon(points, 10, c);
+}
+
+static void benchPolygonFilled(int i, float x, float y, float s, Color c) {
+  float points[10];
+  for (int k = 0; k < 10; k += 2) {
+    points[k] = x + polygon[k] * s;
+    points[k+1] = y + polygon[k+1] * s;
+  }
+  drawPolygonFilled(points, 10, c);
+}
+
+static void benchText(int i, float x, float y, float s, Color c) { drawText("value: 42", x, y, 1, c); }
+
+// A filled box, its outline and a label, the mix that switches primitive
+// type and texture on every call
+static void benchMixed(int i, float x, float y, float s, Color c) {
+  drawRectangleFilled(x, y, s, s, c);
+  drawRectangle(x, y, s, s, c);
+  drawText("42", x + 2, y + 2, 1, c);
+}
+
+static volatile int sink;
+static void benchMeasureText(int i, float x, float y, float s, Color c) { sink += measureText("value: 42\nunit", 1).x; }
+
+static const Benchmark benchmarks[] = {
+  { "line",              benchLine },
+  { "triangle",          benchTriangle },
+  { "triangle_filled",   benchTriangleFilled },
+  { "rectangle",         benchRectangle },
+  { "rectangle_filled",  benchRectangleFilled },
+  { "polygon",           benchPolygon },
+  { "polygon_filled",    benchPolygonFilled },
+  { "circle",            benchCircle },
+  { "circle_filled",     benchCircleFilled },
+  { "slice",             benchSlice },
+  { "slice_filled",      benchSliceFilled },
+  { "arc",               benchArc },
+  { "arc_filled",        benchArcFilled },
+  { "text",              benchText },
+  { "mixed",             benchMixed },
+  { "measure_text",      benchMeasureText },
+};
+
+static const int scales[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+static double now() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Deterministic positions so runs are comparable between versions
+static unsigned int seed;
+static float randf() {
+  seed = seed * 1664525u + 1013904223u;
+  return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+int main(int argc, char **argv) {
+  int csv = 0;
+  int frames = 20;
+  int max = 100000;
+  const char *filter = NULL;
+  
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      csv = 1;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+      max = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--csv] [--frames N] [--max N] [--filter name]\n", argv[0]);
+      return 1;
+    }
+  }
+  
+  windowInit(WIDTH, HEIGHT, "minibench");
+  windowSetVSync(0);
+  windowSetTargetFPS(0);
+  
+  if (csv) {
+    printf("backend,primitive,shapes,frames,ns_per_shape,vertices_per_frame,flushes_per_frame,fps\n");
+  } else {
+    printf("%-18s %8s %14s %12s %10s %10s\n", "primitive", "shapes", "ns/shape", "vertices", "flushes", "fps");
+  }
+  
+  for (int b = 0; b < (int)(sizeof(benchmarks) / sizeof(benchmarks[0])); ++b) {
+    const Benchmark *bench = &benchmarks[b];
+    if (filter && !strstr(bench->name, filter)) { continue; }
+    
+    for (int s = 0; s < (int)(sizeof(scales) / sizeof(scales[0])); ++s) {
+      int shapes = scales[s];
+      if (shapes > max) { break; }
+      
+      double total = 0.0;
+      BatchStats stats = {0};
+      
+      // One warm-up frame, then the measured ones
+      for (int f = -1; f < frames; ++f) {
+        seed = 12345;
+        windowClear(colorRGB(0, 0, 0));
+        
+        double start = now();
+        for (int i = 0; i < shapes; ++i) {
+          float x = randf() * WIDTH;
+          float y = randf() * HEIGHT;
+          float size = 4.0f + randf() * 28.0f;
+          bench->draw(i, x, y, size, colorRGBA(seed >> 24, seed >> 16, seed >> 8, 0xC0));
+        }
+        windowUpdate();
+        
+        if (f >= 0) {
+          total += now() - start;
+          stats = batchStats();
+        }
+      }
+      
+      double frame = total / frames;
+      double ns = frame * 1e9 / shapes;
+      double fps = frame > 0.0 ? 1.0 / frame : 0.0;
+      
+      if (csv) {
+        printf("%s,%s,%d,%d,%.2f,%d,%d,%.2f\n", BACKEND, bench->name, shapes, frames, ns, stats.vertices, stats.flushes, fps);
+      } else {
+        printf("%-18s %8d %14.2f %12d %10d %10.1f\n", bench->name, shapes, ns, stats.vertices, stats.flushes, fps);
+      }
+      fflush(stdout);
+    }
+  }
+  
+  windowClose();
+  return 0;
+}
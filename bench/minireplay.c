@@ -0,0 +1,127 @@
+// Trace replay
+//
+// Replays a trace recorded with MINI_TRACE as fast as the backend allows
+// and reports the time, vertices and flushes of every frame, then the
+// median, 95th percentile and slowest frame. Built against the software
+// backend it runs headless and can print a checksum of the final image,
+// so two versions can be checked for identical output as well as speed.
+//
+//   minireplay trace [--csv] [--loops N] [--checksum]
+
+#define MINI_IMPLEMENTATION
+#define MINI_FONTS
+#include "../miniengine.h"
+
+#include <string.h>
+#include <time.h>
+
+#ifdef MINI_BACKEND_SOFTWARE
+  #define BACKEND "software"
+#else
+  #define BACKEND "opengl"
+#endif
+
+static double now() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  int csv = 0;
+  int loops = 1;
+  int checksum = 0;
+  
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      csv = 1;
+    } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+      loops = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--checksum") == 0) {
+      checksum = 1;
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = NULL;
+      break;
+    }
+  }
+  
+  if (!path || loops < 1) {
+    fprintf(stderr, "usage: %s trace [--csv] [--loops N] [--checksum]\n", argv[0]);
+    return 1;
+  }
+  
+  Trace trace;
+  if (!traceOpen(&trace, path)) {
+    fprintf(stderr, "%s: cannot read trace %s\n", argv[0], path);
+    return 1;
+  }
+  
+  windowInit(trace.w, trace.h, "minireplay");
+  windowSetVSync(0);
+  windowSetTargetFPS(0);
+  
+  int count = trace.frames * loops;
+  double *times = malloc((count ? count : 1) * sizeof(double));
+  if (!times) { return 1; }
+  
+  if (csv) {
+    printf("backend,loop,frame,ms,vertices,flushes,drawn,culled\n");
+  } else {
+    printf("%8s %10s %12s %10s %10s %10s\n", "frame", "ms", "vertices", "flushes", "drawn", "culled");
+  }
+  
+  for (int l = 0; l < loops; ++l) {
+    for (int f = 0; f < trace.frames; ++f) {
+      double start = now();
+      traceReplay(&trace, f);
+      windowUpdate();
+      double time = now() - start;
+      
+      BatchStats stats = batchStats();
+      times[l * trace.frames + f] = time;
+      
+      if (csv) {
+        printf("%s,%d,%d,%.4f,%d,%d,%d,%d\n", BACKEND, l, f, time * 1e3, stats.vertices, stats.flushes, stats.drawn, stats.culled);
+      } else if (loops == 1) {
+        printf("%8d %10.3f %12d %10d %10d %10d\n", f, time * 1e3, stats.vertices, stats.flushes, stats.drawn, stats.culled);
+      }
+    }
+  }
+  
+  if (count > 0) {
+    qsort(times, count, sizeof(double), compare);
+    double total = 0.0;
+    for (int i = 0; i < count; ++i) { total += times[i]; }
+    
+    fprintf(csv ? stderr : stdout, "%s: %d frames, mean %.3f ms, p50 %.3f ms, p95 %.3f ms, max %.3f ms\n", BACKEND, count,
+            total / count * 1e3, times[count / 2] * 1e3, times[(int)(count * 0.95)] * 1e3, times[count - 1] * 1e3);
+  }
+  
+  #ifdef MINI_BACKEND_SOFTWARE
+    if (checksum) {
+      // FNV-1a over the final framebuffer
+      const unsigned char *pixels = (const unsigned char *)windowPixels();
+      unsigned int hash = 2166136261u;
+      for (size_t i = 0; i < (size_t)trace.w * trace.h * sizeof(Color); ++i) {
+        hash = (hash ^ pixels[i]) * 16777619u;
+      }
+      fprintf(csv ? stderr : stdout, "checksum %08x\n", hash);
+    }
+  #else
+    if (checksum) { fprintf(stderr, "%s: --checksum needs the software backend\n", argv[0]); }
+  #endif
+  
+  free(times);
+  traceClose(&trace);
+  windowClose();
+  return 0;
+}
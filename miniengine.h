@@ -1,5 +1,10 @@
 #ifndef MINI_H
 #define MINI_H
+  // nanosleep and clock_gettime are POSIX, which -std=c11 hides unless asked
+  #if !defined(_WIN32) && !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+    #define _POSIX_C_SOURCE 199309L
+  #endif
+  
   #include <stdlib.h>
   #include <stdbool.h>
   #include <stdio.h>
@@ -13,7 +18,13 @@
   #define MB_MIDDLE 2 
   #define MB_RIGHT  4 
   
+  // Key codes are GLFW's, which all fit below this
+  #define MINI_KEYS 512
+  
   typedef enum { RELEASE, PRESS, CLICK, NONE } MouseState;
+  typedef enum { JOIN_MITER, JOIN_BEVEL, JOIN_ROUND } LineJoin;
+  typedef enum { CAP_BUTT, CAP_SQUARE, CAP_ROUND } LineCap;
+  typedef enum { EVENT_KEY, EVENT_CHAR, EVENT_CURSOR, EVENT_MOUSE } EventType;
   
   // --- Structures --- // 
   typedef struct {
@@ -26,6 +37,13 @@
     int y;
   } Vec2;
   
+  typedef struct {
+    float x;
+    float y;
+    float w;
+    float h;
+  } Rect;
+  
   typedef struct {
     unsigned char r;
     unsigned char g;
@@ -33,16 +51,150 @@
     unsigned char a;
   } Color;
   
+  typedef struct {
+    float x;
+    float y;
+    float u;
+    float v;
+    Color color;
+  } Vertex;
+  
+  // Offscreen image for content that rarely changes. Start from a zeroed
+  // Layer; pixels are premultiplied by alpha.
+  typedef struct {
+    unsigned int texture;
+    unsigned int framebuffer;
+    Color *pixels;
+    int w;
+    int h;
+    int valid;
+  } Layer;
+  
+  // RGBA8 image; an id of 0 is no texture
+  typedef struct {
+    unsigned int id;
+    int w;
+    int h;
+  } Texture;
+  
+  // Rectangle of a texture in pixels
+  typedef struct {
+    Texture texture;
+    int x;
+    int y;
+    int w;
+    int h;
+  } Sprite;
+  
+  // Packs sprites into one texture. The skyline is the top edge of the
+  // packed area: segment i starts at skyline[i] and runs to the next one.
+  typedef struct {
+    Texture texture;
+    Vec2 *skyline;
+    int nodes;
+  } Atlas;
+  
+  // drawn and culled count shapes tested against the visible area, saved
+  // the changes of primitive type or texture MINI_QUEUE sorted away
+  typedef struct {
+    int vertices;
+    int flushes;
+    int drawn;
+    int culled;
+    int saved;
+  } BatchStats;
+  
+  typedef struct {
+    int hits;
+    int misses;
+    int evictions;
+    int entries;
+  } PolygonCacheStats;
+  
+  // Bytes of frame arena memory; overflows are allocations that did not fit
+  // and went to the heap, after which the arena grows to the peak
+  typedef struct {
+    size_t last;
+    size_t peak;
+    size_t capacity;
+    int overflows;
+  } ArenaStats;
+  
+  typedef struct CommandBlock CommandBlock;
+  
+  // A run of vertices sharing one primitive type and texture
+  typedef struct {
+    int mode;
+    unsigned int texture;
+    CommandBlock *block;
+    int start;
+    int count;
+  } Command;
+  
+  // Zero-initialize before first use; memory is kept across recordings
+  typedef struct {
+    CommandBlock *first;
+    CommandBlock *current;
+    Command *commands;
+    int count;
+    int capacity;
+    int drawn;
+    int culled;
+  } CommandList;
+  
+  #ifdef MINI_PROFILER
+    typedef enum { PROFILE_DRAW, PROFILE_FLUSH, PROFILE_SWAP, PROFILE_EVENTS, PROFILE_SLEEP, PROFILE_PHASES } ProfilePhase;
+    
+    // Seconds spent in each phase of one frame; PROFILE_DRAW is the caller's
+    // own code between windowUpdate calls, minus any flushes it triggered
+    typedef struct {
+      double time;
+      double phases[PROFILE_PHASES];
+      int calls;
+      int vertices;
+    } ProfileFrame;
+  #endif
+  
+  // code is the key, the codepoint or the MB_* button; action is RELEASE,
+  // PRESS or 2 for a repeated key; x and y are set for every event
+  typedef struct {
+    EventType type;
+    double time;
+    int code;
+    int action;
+    int mods;
+    float x;
+    float y;
+  } Event;
+  
+  // A trace opened for replay. Frame i spans data[index[i]] up to
+  // data[index[i+1]].
+  typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const unsigned long long *index;
+    int frames;
+    int w;
+    int h;
+  } Trace;
+  
+  // held, pressed and released are MB_* masks, the last two for this frame
   typedef struct {
     int x;
     int y;
     MouseState state;
     int button;
+    int held;
+    int pressed;
+    int released;
   } Mouse;
   
   typedef struct {
     int state;
     int key;
+    unsigned char held[MINI_KEYS];
+    unsigned char pressed[MINI_KEYS];
+    unsigned char released[MINI_KEYS];
   } Keyboard;
   
   typedef struct {
@@ -55,6 +207,11 @@
     Keyboard keyboard;
     double prev;
     double dt;
+    double accumulator;
+    double timeout;
+    int fps;
+    int vsync;
+    int lowlatency;
   } Window;
   
   // --- Functions --- // 
@@ -62,6 +219,12 @@
   void windowUpdate();
   void windowClose();
   void windowClear(Color color);
+  int windowShouldClose();
+  
+  #ifdef MINI_BACKEND_SOFTWARE
+    // Row-major RGBA framebuffer of w * h pixels, top row first
+    Color *windowPixels();
+  #endif
   
   Color colorHex(unsigned int c);
   Color colorRGB(int r, int g, int b);
@@ -70,6 +233,13 @@
   // Time
   double delta();
   
+  // Loop
+  void windowSetTargetFPS(int fps);
+  void windowSetVSync(int enabled);
+  void windowSetLowLatency(int enabled);
+  void windowSetWakeTimeout(double seconds);
+  void loopRun(double step, void (*update)(double step), void (*render)(double alpha));
+  
   // Input
   Vec2 mousePosition();
   int mouseClicked(int button);
@@ -77,8 +247,96 @@
   int mouseReleased(int button);
   
   int keyPressed(int key);
+  int keyHeld(int key);
   int keyReleased(int key);
   
+  // Events
+  void eventPush(Event event);
+  int eventNext(Event *event);
+  int eventsDropped();
+  
+  // Command lists: recording threads may only draw; clipping and layers
+  // belong to the main thread and are ignored while recording
+  void commandListBegin(CommandList *list);
+  void commandListEnd();
+  void commandListSubmit(const CommandList *list);
+  void commandListFree(CommandList *list);
+  
+  // Damage
+  #ifdef MINI_DAMAGE
+    void windowInvalidate(float x, float y, float w, float h);
+    void windowInvalidateAll();
+    int windowDamaged();
+  #endif
+  
+  // Batching
+  void batchFlush();
+  BatchStats batchStats();
+  
+  // Draw queue
+  #ifdef MINI_QUEUE
+    void drawDepth(int depth);
+  #endif
+  
+  // Profiling
+  #ifdef MINI_PROFILER
+    ProfileFrame profileFrame();
+    double profilePercentile(double p);
+    
+    #ifdef MINI_FONTS
+      void drawProfiler(float x, float y);
+    #endif
+  #endif
+  
+  // Tracing: recording needs MINI_TRACE, replay is always available
+  #ifdef MINI_TRACE
+    int traceStart(const char *path);
+    void traceStop();
+  #endif
+  int traceOpen(Trace *trace, const char *path);
+  void traceReplay(const Trace *trace, int frame);
+  void traceClose(Trace *trace);
+  
+  // Frame arena
+  void *frameAlloc(size_t size);
+  ArenaStats arenaStats();
+  
+  // Instances, structure of arrays: xywh holds 4 floats and xyr 3 floats
+  // per instance, colors one Color per instance
+  void drawRectanglesFilled(const float *xywh, const Color *colors, int n);
+  void drawCirclesFilled(const float *xyr, const Color *colors, int n);
+  
+  // Clipping
+  void clipSet(float x, float y, float w, float h);
+  void clipReset();
+  
+  // Textures take tightly packed RGBA rows, top row first; updates are
+  // queued through pixel buffers where available and do not stall the frame
+  Texture textureLoad(const unsigned char *rgba, int w, int h);
+  void textureUpdate(Texture texture, const unsigned char *rgba);
+  void textureUpdateRegion(Texture texture, int x, int y, int w, int h, const unsigned char *rgba);
+  void textureFree(Texture *texture);
+  
+  // Atlas: atlasAdd returns 0 once the image no longer fits
+  int atlasInit(Atlas *atlas, int w, int h);
+  int atlasAdd(Atlas *atlas, const unsigned char *rgba, int w, int h, Sprite *sprite);
+  void atlasFree(Atlas *atlas);
+  
+  // Sprites are tinted by multiplying with color; source is relative to
+  // the sprite and stretched over dest
+  void drawSprite(const Sprite *sprite, float x, float y, Color color);
+  void drawSpriteRegion(const Sprite *sprite, Rect source, Rect dest, Color color);
+  
+  // Layers: draw only while layerBegin returns 1, then call layerEnd
+  int layerBegin(Layer *layer, int w, int h);
+  void layerEnd();
+  void layerDraw(const Layer *layer, float x, float y);
+  void layerInvalidate(Layer *layer);
+  void layerFree(Layer *layer);
+  
+  // Polygon cache
+  PolygonCacheStats polygonCacheStats();
+  
   // Shapes
   void drawLine(float x0, float y0, float x1, float y1, Color color);
   void drawTriangle(float x0, float y0, float x1, float y1, float x2, float y2, Color color);
@@ -93,6 +351,16 @@
   void drawSliceFilled(float x, float y, float r, float start, float end, Color color);
   void drawArc(float x, float y, float r1, float thickness, float start, float end, Color color);
   void drawArcFilled(float x, float y, float r1, float thickness, float start, float end, Color color);
+  
+  // Width of circle, slice and arc outlines drawn as signed-distance quads,
+  // 1 by default; tessellated outlines stay 1 px lines
+  void outlineWidth(float width);
+  
+  // Polylines take count floats like polygons. Points closer than decimate
+  // pixels to the last kept point are skipped; 0 keeps every point. The
+  // style applies to the calling thread only.
+  void lineStyle(LineJoin join, LineCap cap, float decimate);
+  void drawPolyline(const float *points, int count, float thickness, Color color);
 #endif // MINI_H
 
 // ------------------------------------ //
@@ -100,91 +368,2728 @@
 // ------------------------------------ //
 #ifdef MINI_IMPLEMENTATION
   #include <math.h>
-  #include <GLFW/glfw3.h>
+  #include <stddef.h>
+  #include <string.h>
+  #include <stdatomic.h>
+  #include <time.h>
   
-  #ifdef MINI_FONTS
-    #include "./addons/minifonts.h"
+  #ifdef _WIN32
+    __declspec(dllimport) void __stdcall Sleep(unsigned long ms);
   #endif
-
-  GLFWwindow *glfw_window;
-
+  
+  #ifdef MINI_BACKEND_SOFTWARE
+    
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+      #include <emmintrin.h>
+      #define MINI_SSE2
+    #endif
+    
+    // Primitive modes keep their OpenGL values
+    #define GL_LINES          0x0001
+    #define GL_LINE_LOOP      0x0002
+    #define GL_TRIANGLES      0x0004
+    #define GL_TRIANGLE_STRIP 0x0005
+    #define GL_TRIANGLE_FAN   0x0006
+  #else
+    #include <GLFW/glfw3.h>
+  #endif
+  
+  #ifndef MINI_BATCH_CAPACITY
+    #define MINI_BATCH_CAPACITY 65536
+  #endif
+  
+  // Vertices per command list block
+  #ifndef MINI_COMMAND_BLOCK
+    #define MINI_COMMAND_BLOCK 16384
+  #endif
+  
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #define MINI_THREAD_LOCAL __declspec(thread)
+  #else
+    #define MINI_THREAD_LOCAL _Thread_local
+  #endif
+  
+  // Triangulated polygons are cached in MINI_POLYGON_CACHE sets of
+  // MINI_POLYGON_WAYS entries, keyed by a hash of their points
+  #ifndef MINI_POLYGON_CACHE
+    #define MINI_POLYGON_CACHE 64
+  #endif
+  
+  #ifndef MINI_POLYGON_WAYS
+    #define MINI_POLYGON_WAYS 4
+  #endif
+  
+  // Initial frame arena size; every allocation is aligned to MINI_ARENA_ALIGN,
+  // which must be a power of two
+  #ifndef MINI_ARENA_SIZE
+    #define MINI_ARENA_SIZE (1 << 20)
+  #endif
+  
+  #ifndef MINI_ARENA_ALIGN
+    #define MINI_ARENA_ALIGN 16
+  #endif
+  
+  #ifndef MINI_TRIG_SIZE
+    #define MINI_TRIG_SIZE 1024
+  #endif
+  
+  // Maximum distance in pixels between a curve and its segments
+  #ifndef MINI_CURVE_TOLERANCE
+    #define MINI_CURVE_TOLERANCE 0.25f
+  #endif
+  
+  #ifndef MINI_SEGMENTS_MAX
+    #define MINI_SEGMENTS_MAX 360
+  #endif
+  
+  // Miters longer than this many half thicknesses are beveled
+  #ifndef MINI_MITER_LIMIT
+    #define MINI_MITER_LIMIT 4.0f
+  #endif
+  
+  // Fixed steps run per frame at most, so a long stall cannot snowball
+  #ifndef MINI_LOOP_MAX_STEPS
+    #define MINI_LOOP_MAX_STEPS 8
+  #endif
+  
+  // Must be a power of two
+  #ifndef MINI_EVENT_QUEUE
+    #define MINI_EVENT_QUEUE 256
+  #endif
+  
+  // Frames kept for the rolling frame-time histogram
+  #ifndef MINI_PROFILER_FRAMES
+    #define MINI_PROFILER_FRAMES 240
+  #endif
+  
+  // Separate damaged rectangles kept per frame before they are merged
+  #ifndef MINI_DAMAGE_RECTS
+    #define MINI_DAMAGE_RECTS 8
+  #endif
+  
+  // Frames a back buffer stays stale: 2 for double buffered flips, 1 when
+  // the swap copies. The software framebuffer is always current.
+  #ifndef MINI_BUFFER_AGE
+    #ifdef MINI_BACKEND_SOFTWARE
+      #define MINI_BUFFER_AGE 1
+    #else
+      #define MINI_BUFFER_AGE 2
+    #endif
+  #endif
+  
+  // Circles, slices and arcs drawn as one shader-shaded quad each; only
+  // the GL backend has shaders
+  #if defined(MINI_SDF) && defined(MINI_BACKEND_SOFTWARE)
+    #undef MINI_SDF
+  #endif
+  
+  #ifndef MINI_SOFTWARE_TEXTURES
+    #define MINI_SOFTWARE_TEXTURES 64
+  #endif
+  
+  // Pixel unpack buffers texture updates rotate through
+  #ifndef MINI_UPLOAD_BUFFERS
+    #define MINI_UPLOAD_BUFFERS 2
+  #endif
+  
+  // Empty pixels kept between atlas sprites
+  #ifndef MINI_ATLAS_PADDING
+    #define MINI_ATLAS_PADDING 1
+  #endif
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    GLFWwindow *glfw_window;
+  #endif
+  
+  Window mini_window;
+  
+  #ifdef MINI_SDF
+    // Batches with this texture are shaded from their SdfParams
+    #define MINI_TEXTURE_SDF 0xFFFFFFFFu
+    
+    // Radii and angles in turns; inner is negative for shapes without a
+    // hole, and stroke is 0 for filled shapes
+    typedef struct {
+      float inner;
+      float outer;
+      float start;
+      float sweep;
+      float stroke;
+    } SdfParams;
+  #endif
+  
+  typedef struct {
+    Vertex vertices[MINI_BATCH_CAPACITY];
+    #ifdef MINI_SDF
+      SdfParams sdf[MINI_BATCH_CAPACITY];
+    #endif
+    int count;
+    int mode;
+    unsigned int texture;
+    BatchStats frame;
+    BatchStats last;
+  } Batch;
+  
+  Batch batch;
+  
   // --- INTERNAL --- //
-  void _resize(int w, int h) {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, w, h, 0, 0.0f, 1.0f);
-  };
+  #ifndef MINI_BACKEND_SOFTWARE
+    void _resize(int w, int h) {
+      glMatrixMode(GL_PROJECTION);
+      glLoadIdentity();
+      glOrtho(0, w, h, 0, 0.0f, 1.0f);
+    };
+    
+  #endif
+  
+  double _now() {
+    #if !defined(MINI_BACKEND_SOFTWARE)
+      return glfwGetTime();
+    #else
+      static double origin = -1.0;
+      struct timespec ts;
+      #if defined(CLOCK_MONOTONIC)
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+      #else
+        timespec_get(&ts, TIME_UTC);
+      #endif
+      double t = ts.tv_sec + ts.tv_nsec * 1e-9;
+      if (origin < 0.0) { origin = t; }
+      return t - origin;
+    #endif
+  }
   
-  void _mouseButton(GLFWwindow *window, int button, int action, int mods) {
-    Window *win = glfwGetWindowUserPointer(window);
-    win->mouse.button = button;
-    win->mouse.state = action;
+  void _sleep(double seconds) {
+    // Without POSIX timers in view _pace spins for the whole wait
+    #ifdef _WIN32
+      Sleep((unsigned long)(seconds * 1000.0));
+    #elif defined(CLOCK_MONOTONIC)
+      struct timespec ts;
+      ts.tv_sec = (time_t)seconds;
+      ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+      nanosleep(&ts, NULL);
+    #endif
   }
   
-  // --- WINDOW --- //
+  // Waits until one target frame period after the previous frame started.
+  // The OS sleep stops a millisecond early and the rest is spun, since
+  // sleeps routinely overshoot by more than that.
+  void _pace() {
+    if (mini_window.fps <= 0) { return; }
+    
+    double deadline = mini_window.prev + 1.0 / mini_window.fps;
+    double remaining = deadline - _now();
+    
+    if (remaining > 0.002) {
+      _sleep(remaining - 0.001);
+    }
+    while (_now() < deadline) {}
+  }
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    // --- GL FUNCTIONS --- //
+    // Anything past OpenGL 1.1 is loaded at runtime. A NULL pointer means the
+    // driver lacks it, and callers fall back to the fixed-function path.
+    #ifdef _WIN32
+      #define MINI_GLAPI __stdcall
+    #else
+      #define MINI_GLAPI
+    #endif
+    
+    #ifndef GL_VERTEX_SHADER
+      #define GL_FRAGMENT_SHADER 0x8B30
+      #define GL_VERTEX_SHADER   0x8B31
+      #define GL_COMPILE_STATUS  0x8B81
+      #define GL_LINK_STATUS     0x8B82
+    #endif
+    
+    #ifndef GL_PIXEL_PACK_BUFFER
+      #define GL_STREAM_DRAW          0x88E0
+      #define GL_STREAM_READ          0x88E1
+      #define GL_READ_ONLY            0x88B8
+      #define GL_WRITE_ONLY           0x88B9
+      #define GL_PIXEL_PACK_BUFFER    0x88EB
+      #define GL_PIXEL_UNPACK_BUFFER  0x88EC
+    #endif
+    
+    #ifndef GL_FRAMEBUFFER
+      #define GL_FRAMEBUFFER          0x8D40
+      #define GL_COLOR_ATTACHMENT0    0x8CE0
+      #define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+    #endif
+    
+    void (MINI_GLAPI *_glBlendFuncSeparate)(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+    
+    GLuint (MINI_GLAPI *_glCreateShader)(GLenum type);
+    void (MINI_GLAPI *_glShaderSource)(GLuint shader, GLsizei count, const char *const *source, const GLint *length);
+    void (MINI_GLAPI *_glCompileShader)(GLuint shader);
+    void (MINI_GLAPI *_glGetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+    void (MINI_GLAPI *_glDeleteShader)(GLuint shader);
+    GLuint (MINI_GLAPI *_glCreateProgram)(void);
+    void (MINI_GLAPI *_glAttachShader)(GLuint program, GLuint shader);
+    void (MINI_GLAPI *_glBindAttribLocation)(GLuint program, GLuint index, const char *name);
+    void (MINI_GLAPI *_glLinkProgram)(GLuint program);
+    void (MINI_GLAPI *_glGetProgramiv)(GLuint program, GLenum pname, GLint *params);
+    void (MINI_GLAPI *_glUseProgram)(GLuint program);
+    GLint (MINI_GLAPI *_glGetUniformLocation)(GLuint program, const char *name);
+    void (MINI_GLAPI *_glUniform1f)(GLint location, GLfloat v0);
+    void (MINI_GLAPI *_glEnableVertexAttribArray)(GLuint index);
+    void (MINI_GLAPI *_glDisableVertexAttribArray)(GLuint index);
+    void (MINI_GLAPI *_glVertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+    void (MINI_GLAPI *_glVertexAttribDivisor)(GLuint index, GLuint divisor);
+    void (MINI_GLAPI *_glDrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+    void (MINI_GLAPI *_glGenFramebuffers)(GLsizei n, GLuint *framebuffers);
+    void (MINI_GLAPI *_glDeleteFramebuffers)(GLsizei n, const GLuint *framebuffers);
+    void (MINI_GLAPI *_glBindFramebuffer)(GLenum target, GLuint framebuffer);
+    void (MINI_GLAPI *_glFramebufferTexture2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    GLenum (MINI_GLAPI *_glCheckFramebufferStatus)(GLenum target);
+    void (MINI_GLAPI *_glGenBuffers)(GLsizei n, GLuint *buffers);
+    void (MINI_GLAPI *_glDeleteBuffers)(GLsizei n, const GLuint *buffers);
+    void (MINI_GLAPI *_glBindBuffer)(GLenum target, GLuint buffer);
+    void (MINI_GLAPI *_glBufferData)(GLenum target, ptrdiff_t size, const void *data, GLenum usage);
+    void *(MINI_GLAPI *_glMapBuffer)(GLenum target, GLenum access);
+    GLboolean (MINI_GLAPI *_glUnmapBuffer)(GLenum target);
+    
+    // Copied rather than cast through a pointer, which breaks strict aliasing
+    #define _GL_LOAD(name, symbol) do { GLFWglproc _proc = glfwGetProcAddress(symbol); memcpy(&_##name, &_proc, sizeof(_proc)); } while (0)
+    
+    void _glLoad() {
+      int version = glfwGetWindowAttrib(glfw_window, GLFW_CONTEXT_VERSION_MAJOR) * 10
+                  + glfwGetWindowAttrib(glfw_window, GLFW_CONTEXT_VERSION_MINOR);
+      
+      if (version >= 14) {
+        _GL_LOAD(glBlendFuncSeparate, "glBlendFuncSeparate");
+      }
+      
+      if (version >= 20) {
+        _GL_LOAD(glCreateShader, "glCreateShader");
+        _GL_LOAD(glShaderSource, "glShaderSource");
+        _GL_LOAD(glCompileShader, "glCompileShader");
+        _GL_LOAD(glGetShaderiv, "glGetShaderiv");
+        _GL_LOAD(glDeleteShader, "glDeleteShader");
+        _GL_LOAD(glCreateProgram, "glCreateProgram");
+        _GL_LOAD(glAttachShader, "glAttachShader");
+        _GL_LOAD(glBindAttribLocation, "glBindAttribLocation");
+        _GL_LOAD(glLinkProgram, "glLinkProgram");
+        _GL_LOAD(glGetProgramiv, "glGetProgramiv");
+        _GL_LOAD(glUseProgram, "glUseProgram");
+        _GL_LOAD(glGetUniformLocation, "glGetUniformLocation");
+        _GL_LOAD(glUniform1f, "glUniform1f");
+        _GL_LOAD(glEnableVertexAttribArray, "glEnableVertexAttribArray");
+        _GL_LOAD(glDisableVertexAttribArray, "glDisableVertexAttribArray");
+        _GL_LOAD(glVertexAttribPointer, "glVertexAttribPointer");
+      }
+      
+      if (version >= 33) {
+        _GL_LOAD(glVertexAttribDivisor, "glVertexAttribDivisor");
+        _GL_LOAD(glDrawArraysInstanced, "glDrawArraysInstanced");
+      } else if (glfwExtensionSupported("GL_ARB_instanced_arrays") && glfwExtensionSupported("GL_ARB_draw_instanced")) {
+        _GL_LOAD(glVertexAttribDivisor, "glVertexAttribDivisorARB");
+        _GL_LOAD(glDrawArraysInstanced, "glDrawArraysInstancedARB");
+      }
+      
+      // Pixel buffers for asynchronous readback and uploads
+      if (version >= 21 || glfwExtensionSupported("GL_ARB_pixel_buffer_object")) {
+        _GL_LOAD(glGenBuffers, "glGenBuffers");
+        _GL_LOAD(glDeleteBuffers, "glDeleteBuffers");
+        _GL_LOAD(glBindBuffer, "glBindBuffer");
+        _GL_LOAD(glBufferData, "glBufferData");
+        _GL_LOAD(glMapBuffer, "glMapBuffer");
+        _GL_LOAD(glUnmapBuffer, "glUnmapBuffer");
+      }
+      
+      if (version >= 30 || glfwExtensionSupported("GL_ARB_framebuffer_object")) {
+        _GL_LOAD(glGenFramebuffers, "glGenFramebuffers");
+        _GL_LOAD(glDeleteFramebuffers, "glDeleteFramebuffers");
+        _GL_LOAD(glBindFramebuffer, "glBindFramebuffer");
+        _GL_LOAD(glFramebufferTexture2D, "glFramebufferTexture2D");
+        _GL_LOAD(glCheckFramebufferStatus, "glCheckFramebufferStatus");
+      } else if (glfwExtensionSupported("GL_EXT_framebuffer_object")) {
+        _GL_LOAD(glGenFramebuffers, "glGenFramebuffersEXT");
+        _GL_LOAD(glDeleteFramebuffers, "glDeleteFramebuffersEXT");
+        _GL_LOAD(glBindFramebuffer, "glBindFramebufferEXT");
+        _GL_LOAD(glFramebufferTexture2D, "glFramebufferTexture2DEXT");
+        _GL_LOAD(glCheckFramebufferStatus, "glCheckFramebufferStatusEXT");
+      }
+    }
+    
+    // Links a GLSL program with attributes bound to their index in attribs;
+    // returns 0 without shader support or when compiling fails
+    GLuint _glProgram(const char *vertex, const char *fragment, const char **attribs, int count) {
+      if (!_glCreateShader) { return 0; }
+      
+      const char *sources[2] = {vertex, fragment};
+      GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+      GLuint program = _glCreateProgram();
+      GLint ok = 1;
+      
+      for (int i = 0; i < 2 && ok; ++i) {
+        GLuint shader = _glCreateShader(types[i]);
+        _glShaderSource(shader, 1, &sources[i], NULL);
+        _glCompileShader(shader);
+        _glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        _glAttachShader(program, shader);
+        _glDeleteShader(shader);
+      }
+      if (!ok) { return 0; }
+      
+      for (int i = 0; i < count; ++i) {
+        _glBindAttribLocation(program, i, attribs[i]);
+      }
+      _glLinkProgram(program);
+      _glGetProgramiv(program, GL_LINK_STATUS, &ok);
+      return ok ? program : 0;
+    }
+  #endif
+  
+  // --- FRAME ARENA --- //
+  // Transient memory for the current frame, released all at once by
+  // windowUpdate. Main thread only. With MINI_ARENA_DEBUG, released memory
+  // is filled with 0xDD so anything kept across frames reads garbage.
+  typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+  } ArenaBlock;
+  
+  typedef struct {
+    unsigned char *memory;
+    unsigned char *base;
+    size_t used;
+    size_t total;
+    ArenaBlock *overflow;
+    ArenaStats stats;
+  } Arena;
+  
+  Arena arena;
+  
+  #define _ALIGN_UP(n) (((n) + MINI_ARENA_ALIGN - 1) & ~(size_t)(MINI_ARENA_ALIGN - 1))
+  
+  static void _arenaReserve(size_t capacity) {
+    free(arena.memory);
+    arena.memory = malloc(capacity + MINI_ARENA_ALIGN);
+    if (!arena.memory) { exit(-1); }
+    arena.base = (unsigned char *)_ALIGN_UP((size_t)arena.memory);
+    arena.stats.capacity = capacity;
+  }
+  
+  void *frameAlloc(size_t size) {
+    size = _ALIGN_UP(size);
+    if (!arena.memory) { _arenaReserve(MINI_ARENA_SIZE); }
+    
+    arena.total += size;
+    if (arena.total > arena.stats.peak) { arena.stats.peak = arena.total; }
+    
+    if (arena.used + size <= arena.stats.capacity) {
+      void *ptr = arena.base + arena.used;
+      arena.used += size;
+      return ptr;
+    }
+    
+    // Kept valid until the reset, like the rest of the frame
+    size_t header = _ALIGN_UP(sizeof(ArenaBlock));
+    unsigned char *block = malloc(header + size + MINI_ARENA_ALIGN);
+    if (!block) { exit(-1); }
+    ((ArenaBlock *)block)->next = arena.overflow;
+    arena.overflow = (ArenaBlock *)block;
+    arena.stats.overflows++;
+    return (void *)_ALIGN_UP((size_t)(block + header));
+  }
+  
+  ArenaStats arenaStats() { return arena.stats; }
+  
+  void _arenaReset() {
+    #ifdef MINI_ARENA_DEBUG
+      if (arena.base) { memset(arena.base, 0xDD, arena.used); }
+    #endif
+    
+    while (arena.overflow) {
+      ArenaBlock *next = arena.overflow->next;
+      free(arena.overflow);
+      arena.overflow = next;
+    }
+    
+    if (arena.stats.peak > arena.stats.capacity) {
+      _arenaReserve(_ALIGN_UP(arena.stats.peak));
+    }
+    
+    arena.stats.last = arena.total;
+    arena.used = 0;
+    arena.total = 0;
+  }
+  
+  void _arenaFree() {
+    _arenaReset();
+    free(arena.memory);
+    arena = (Arena){0};
+  }
+  
+  // --- TRACE --- //
+  // Draw calls, clears and consumed input events are appended to a frame
+  // buffer as records padded to 8 bytes, which windowUpdate writes out. An
+  // index of frame offsets follows the last frame, so a replay can map the
+  // file and seek to any frame. Calls made while recording a command list
+  // are not traced, nor are textures and layers.
+  typedef enum {
+    TRACE_OP_CLEAR = 1,
+    TRACE_OP_LINE,
+    TRACE_OP_TRIANGLE,
+    TRACE_OP_RECTANGLE,
+    TRACE_OP_POLYGON,
+    TRACE_OP_CIRCLE,
+    TRACE_OP_SLICE,
+    TRACE_OP_ARC,
+    TRACE_OP_RECTANGLES,
+    TRACE_OP_CIRCLES,
+    TRACE_OP_POLYLINE,
+    TRACE_OP_LINE_STYLE,
+    TRACE_OP_TEXT,
+    TRACE_OP_CLIP,
+    TRACE_OP_CLIP_RESET,
+    TRACE_OP_EVENT,
+    TRACE_OP_DEPTH,
+    TRACE_OP_OUTLINE_WIDTH
+  } TraceOp;
+  
+  #define TRACE_MAGIC "MINITRC1"
+  #define TRACE_VERSION 1
+  
+  // index is the file offset of frames + 1 frame offsets
+  typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int frames;
+    int w;
+    int h;
+    unsigned long long index;
+  } TraceHeader;
+  
+  // size counts the padded payload that follows
+  typedef struct {
+    unsigned short op;
+    unsigned short mode;
+    unsigned int size;
+  } TraceRecord;
+  
+  #ifdef MINI_TRACE
+    typedef struct {
+      FILE *file;
+      unsigned char *data;
+      size_t size;
+      size_t capacity;
+      unsigned long long offset;
+      unsigned long long *index;
+      int frames;
+      int index_capacity;
+    } Tracer;
+    
+    Tracer tracer;
+    
+    // Shapes store their float arguments, then their color, then any data
+    #define TRACE_ARGS(op, mode, ...) do { if (!recording && tracer.file) { float _args[] = {__VA_ARGS__}; _traceWrite(op, mode, _args, sizeof(_args), NULL, 0, NULL, 0); } } while (0)
+    #define TRACE_SHAPE(op, mode, color, ...) TRACE_SHAPE_DATA(op, mode, color, NULL, 0, __VA_ARGS__)
+    #define TRACE_SHAPE_DATA(op, mode, color, data, size, ...) do { if (!recording && tracer.file) { float _args[] = {__VA_ARGS__}; _traceWrite(op, mode, _args, sizeof(_args), &(color), sizeof(Color), data, size); } } while (0)
+    #define TRACE_DATA(op, mode, a, an, b, bn, c, cn) do { if (!recording && tracer.file) { _traceWrite(op, mode, a, an, b, bn, c, cn); } } while (0)
+    #define TRACE_EVENT(event) do { if (tracer.file) { _traceWrite(TRACE_OP_EVENT, 0, event, sizeof(Event), NULL, 0, NULL, 0); } } while (0)
+    #define TRACE_FRAME() _traceFrame()
+    
+    void _traceWrite(int op, int mode, const void *a, size_t an, const void *b, size_t bn, const void *c, size_t cn) {
+      size_t size = (an + bn + cn + 7) & ~(size_t)7;
+      size_t needed = tracer.size + sizeof(TraceRecord) + size;
+      
+      if (needed > tracer.capacity) {
+        size_t capacity = tracer.capacity ? tracer.capacity : 65536;
+        while (capacity < needed) { capacity *= 2; }
+        tracer.data = realloc(tracer.data, capacity);
+        if (!tracer.data) { exit(-1); }
+        tracer.capacity = capacity;
+      }
+      
+      unsigned char *p = tracer.data + tracer.size;
+      *(TraceRecord *)p = (TraceRecord){(unsigned short)op, (unsigned short)mode, (unsigned int)size};
+      p += sizeof(TraceRecord);
+      if (an) { memcpy(p, a, an); }
+      if (bn) { memcpy(p + an, b, bn); }
+      if (cn) { memcpy(p + an + bn, c, cn); }
+      memset(p + an + bn + cn, 0, size - an - bn - cn);
+      tracer.size = needed;
+    }
+    
+    // Everything buffered since the last call becomes one frame
+    void _traceFrame() {
+      if (!tracer.file) { return; }
+      
+      if (tracer.frames + 2 > tracer.index_capacity) {
+        tracer.index_capacity *= 2;
+        tracer.index = realloc(tracer.index, tracer.index_capacity * sizeof(unsigned long long));
+        if (!tracer.index) { exit(-1); }
+      }
+      
+      fwrite(tracer.data, 1, tracer.size, tracer.file);
+      tracer.offset += tracer.size;
+      tracer.size = 0;
+      tracer.index[++tracer.frames] = tracer.offset;
+    }
+    
+    int traceStart(const char *path) {
+      traceStop();
+      tracer.file = fopen(path, "wb");
+      if (!tracer.file) { return 0; }
+      
+      // Rewritten with the frame count and index by traceStop
+      TraceHeader header = {TRACE_MAGIC, TRACE_VERSION, 0, mini_window.w, mini_window.h, 0};
+      fwrite(&header, sizeof(header), 1, tracer.file);
+      
+      tracer.offset = sizeof(header);
+      tracer.index_capacity = 1024;
+      tracer.index = malloc(tracer.index_capacity * sizeof(unsigned long long));
+      if (!tracer.index) { exit(-1); }
+      tracer.index[0] = tracer.offset;
+      return 1;
+    }
+    
+    void traceStop() {
+      if (!tracer.file) { return; }
+      if (tracer.size) { _traceFrame(); }
+      
+      fwrite(tracer.index, sizeof(unsigned long long), tracer.frames + 1, tracer.file);
+      TraceHeader header = {TRACE_MAGIC, TRACE_VERSION, tracer.frames, mini_window.w, mini_window.h, tracer.offset};
+      fseek(tracer.file, 0, SEEK_SET);
+      fwrite(&header, sizeof(header), 1, tracer.file);
+      fclose(tracer.file);
+      
+      free(tracer.data);
+      free(tracer.index);
+      tracer = (Tracer){0};
+    }
+  #else
+    #define TRACE_ARGS(op, mode, ...)
+    #define TRACE_SHAPE(op, mode, color, ...)
+    #define TRACE_SHAPE_DATA(op, mode, color, data, size, ...)
+    #define TRACE_DATA(op, mode, a, an, b, bn, c, cn)
+    #define TRACE_EVENT(event)
+    #define TRACE_FRAME()
+  #endif
+  
+  // --- EVENTS --- //
+  // Single-producer single-consumer ring. Callbacks push timestamped events
+  // while glfwPollEvents runs; windowUpdate then derives the frame's edge
+  // state from everything pushed since the previous update, and eventNext
+  // hands the same events to the caller until the next update.
+  typedef struct {
+    Event events[MINI_EVENT_QUEUE];
+    atomic_uint write;
+    atomic_uint read;
+    unsigned int frame_end;
+    atomic_int dropped;
+  } EventQueue;
+  
+  EventQueue event_queue;
+  
+  void eventPush(Event event) {
+    unsigned int w = atomic_load_explicit(&event_queue.write, memory_order_relaxed);
+    unsigned int r = atomic_load_explicit(&event_queue.read, memory_order_acquire);
+    
+    if (w - r == MINI_EVENT_QUEUE) {
+      atomic_fetch_add_explicit(&event_queue.dropped, 1, memory_order_relaxed);
+      return;
+    }
+    
+    event_queue.events[w & (MINI_EVENT_QUEUE - 1)] = event;
+    atomic_store_explicit(&event_queue.write, w + 1, memory_order_release);
+  }
+  
+  int eventNext(Event *event) {
+    unsigned int r = atomic_load_explicit(&event_queue.read, memory_order_relaxed);
+    if (r == event_queue.frame_end) { return 0; }
+    
+    *event = event_queue.events[r & (MINI_EVENT_QUEUE - 1)];
+    atomic_store_explicit(&event_queue.read, r + 1, memory_order_release);
+    return 1;
+  }
+  
+  int eventsDropped() {
+    return atomic_load_explicit(&event_queue.dropped, memory_order_relaxed);
+  }
+  
+  void _inputUpdate() {
+    Mouse *mouse = &mini_window.mouse;
+    Keyboard *keyboard = &mini_window.keyboard;
+    
+    mini_window.mouseprev = *mouse;
+    mouse->pressed = 0;
+    mouse->released = 0;
+    memset(keyboard->pressed, 0, sizeof(keyboard->pressed));
+    memset(keyboard->released, 0, sizeof(keyboard->released));
+    
+    // Events the caller did not consume last frame are dropped here
+    unsigned int r = event_queue.frame_end;
+    atomic_store_explicit(&event_queue.read, r, memory_order_release);
+    unsigned int end = atomic_load_explicit(&event_queue.write, memory_order_acquire);
+    
+    for (; r != end; ++r) {
+      Event *event = &event_queue.events[r & (MINI_EVENT_QUEUE - 1)];
+      TRACE_EVENT(event);
+      
+      if (event->type == EVENT_CURSOR) {
+        mouse->x = (int)event->x;
+        mouse->y = (int)event->y;
+      } else if (event->type == EVENT_MOUSE) {
+        if (event->action == PRESS) {
+          mouse->held |= event->code;
+          mouse->pressed |= event->code;
+        } else if (event->action == RELEASE) {
+          mouse->held &= ~event->code;
+          mouse->released |= event->code;
+        }
+        mouse->button = event->code;
+      } else if (event->type == EVENT_KEY && event->code >= 0 && event->code < MINI_KEYS) {
+        if (event->action == PRESS) {
+          keyboard->held[event->code] = 1;
+          keyboard->pressed[event->code] = 1;
+        } else if (event->action == RELEASE) {
+          keyboard->held[event->code] = 0;
+          keyboard->released[event->code] = 1;
+        }
+        keyboard->key = event->code;
+        keyboard->state = event->action;
+      }
+    }
+    
+    event_queue.frame_end = end;
+    
+    // A button goes CLICK -> PRESS while held and RELEASE -> NONE once up
+    if (mouse->pressed) {
+      mouse->state = CLICK;
+    } else if (mouse->released) {
+      mouse->state = RELEASE;
+    } else if (mouse->state == CLICK) {
+      mouse->state = PRESS;
+    } else if (mouse->state == RELEASE) {
+      mouse->state = NONE;
+    }
+  }
   
-  void windowInit(int w, int h, const char *title) {
-    if (!glfwInit()) {
-      exit(-1);
+  #ifndef MINI_BACKEND_SOFTWARE
+    static inline Event _event(EventType type, int code, int action, int mods) {
+      double x;
+      double y;
+      glfwGetCursorPos(glfw_window, &x, &y);
+      return (Event){type, _now(), code, action, mods, (float)x, (float)y};
+    }
+    
+    void _keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+      eventPush(_event(EVENT_KEY, key, action, mods));
+    }
+    
+    void _charCallback(GLFWwindow *window, unsigned int codepoint) {
+      eventPush(_event(EVENT_CHAR, (int)codepoint, PRESS, 0));
+    }
+    
+    void _cursorCallback(GLFWwindow *window, double x, double y) {
+      eventPush((Event){EVENT_CURSOR, _now(), 0, 0, 0, (float)x, (float)y});
+    }
+    
+    // GLFW numbers buttons left, right, middle; MB_* are bits
+    void _mouseButton(GLFWwindow *window, int button, int action, int mods) {
+      int mask = button == 0 ? MB_LEFT : button == 1 ? MB_RIGHT : button == 2 ? MB_MIDDLE : 8 << (button - 3);
+      eventPush(_event(EVENT_MOUSE, mask, action, mods));
+    }
+  #endif
+  
+  // --- PROFILER --- //
+  #ifdef MINI_PROFILER
+    // Histogram bins are 0.1 ms wide, the last one collects anything slower
+    #define PROFILER_BINS 500
+    #define PROFILER_BIN_WIDTH 0.0001
+    
+    typedef struct {
+      ProfileFrame current;
+      ProfileFrame last;
+      double start;
+      double phase_start[PROFILE_PHASES];
+      double times[MINI_PROFILER_FRAMES];
+      int head;
+      int count;
+      int bins[PROFILER_BINS];
+    } Profiler;
+    
+    Profiler profiler;
+    
+    #define PROFILE_BEGIN(phase) (profiler.phase_start[phase] = _now())
+    #define PROFILE_END(phase) (profiler.current.phases[phase] += _now() - profiler.phase_start[phase])
+    #define PROFILE_FRAME() _profileFrame()
+    
+    static int _profileBin(double t) {
+      int bin = (int)(t / PROFILER_BIN_WIDTH);
+      return bin < 0 ? 0 : bin >= PROFILER_BINS ? PROFILER_BINS - 1 : bin;
+    }
+    
+    void _profileFrame() {
+      double end = _now();
+      ProfileFrame *frame = &profiler.current;
+      frame->time = end - profiler.start;
+      frame->phases[PROFILE_DRAW] = frame->time - frame->phases[PROFILE_FLUSH] - frame->phases[PROFILE_SWAP]
+                                 - frame->phases[PROFILE_EVENTS] - frame->phases[PROFILE_SLEEP];
+      frame->calls = batch.last.flushes;
+      frame->vertices = batch.last.vertices;
+      
+      if (profiler.count == MINI_PROFILER_FRAMES) {
+        profiler.bins[_profileBin(profiler.times[profiler.head])]--;
+      } else {
+        profiler.count++;
+      }
+      profiler.times[profiler.head] = frame->time;
+      profiler.bins[_profileBin(frame->time)]++;
+      profiler.head = (profiler.head + 1) % MINI_PROFILER_FRAMES;
+      
+      profiler.last = *frame;
+      profiler.current = (ProfileFrame){0};
+      profiler.start = end;
+    }
+    
+    ProfileFrame profileFrame() { return profiler.last; }
+    
+    // Upper edge of the histogram bin holding the p-th fraction of recent frames
+    double profilePercentile(double p) {
+      if (profiler.count == 0) { return 0.0; }
+      
+      int target = (int)ceil(p * profiler.count);
+      if (target < 1) { target = 1; }
+      
+      int seen = 0;
+      for (int i = 0; i < PROFILER_BINS - 1; ++i) {
+        seen += profiler.bins[i];
+        if (seen >= target) { return (i + 1) * PROFILER_BIN_WIDTH; }
+      }
+      
+      double slowest = 0.0;
+      for (int i = 0; i < profiler.count; ++i) {
+        if (profiler.times[i] > slowest) { slowest = profiler.times[i]; }
+      }
+      return slowest;
+    }
+  #else
+    #define PROFILE_BEGIN(phase)
+    #define PROFILE_END(phase)
+    #define PROFILE_FRAME()
+  #endif
+  
+  #ifdef MINI_BACKEND_SOFTWARE
+    // --- SOFTWARE RASTERIZER --- //
+    // Triangles cover the pixels whose centers lie inside them, using
+    // half-open spans so shared edges are filled exactly once. Spans are
+    // stored or blended four pixels at a time with SSE2 when available;
+    // the scalar path rounds identically, so output is the same either way.
+    typedef struct {
+      Color *pixels;
+      int w;
+      int h;
+    } Surface;
+    
+    // Pixel bounds rasterization is limited to, x1 and y1 exclusive
+    typedef struct {
+      int x0;
+      int y0;
+      int x1;
+      int y1;
+    } Bounds;
+    
+    Surface framebuffer;
+    Surface textures[MINI_SOFTWARE_TEXTURES];
+    int texture_count;
+    Bounds clip;
+    
+    static inline unsigned char _div255(unsigned int x) {
+      x += 128;
+      return (x + (x >> 8)) >> 8;
+    }
+    
+    static inline Color _blend(Color dst, Color src) {
+      unsigned int a = src.a;
+      unsigned int ia = 255 - a;
+      return (Color){
+        _div255(src.r * a + dst.r * ia),
+        _div255(src.g * a + dst.g * ia),
+        _div255(src.b * a + dst.b * ia),
+        _div255(src.a * 255 + dst.a * ia),
+      };
+    }
+    
+    static void _spanStore(Color *dst, int n, Color color) {
+      int i = 0;
+      #ifdef MINI_SSE2
+        unsigned int packed;
+        memcpy(&packed, &color, 4);
+        __m128i c = _mm_set1_epi32((int)packed);
+        for (; i + 4 <= n; i += 4) {
+          _mm_storeu_si128((__m128i *)(dst + i), c);
+        }
+      #endif
+      for (; i < n; ++i) { dst[i] = color; }
+    }
+    
+    static void _spanBlend(Color *dst, int n, Color color) {
+      int i = 0;
+      #ifdef MINI_SSE2
+        unsigned int a = color.a;
+        __m128i zero = _mm_setzero_si128();
+        __m128i src = _mm_setr_epi16(color.r * a, color.g * a, color.b * a, a * 255,
+                                     color.r * a, color.g * a, color.b * a, a * 255);
+        __m128i ia = _mm_set1_epi16(255 - a);
+        __m128i half = _mm_set1_epi16(128);
+        
+        for (; i + 4 <= n; i += 4) {
+          __m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+          __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia), src);
+          __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia), src);
+          lo = _mm_add_epi16(lo, half);
+          hi = _mm_add_epi16(hi, half);
+          lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+          hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+          _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+        }
+      #endif
+      for (; i < n; ++i) { dst[i] = _blend(dst[i], color); }
+    }
+    
+    static inline void _spanFill(Color *dst, int n, Color color) {
+      if (n <= 0 || color.a == 0) { return; }
+      if (color.a == 255) {
+        _spanStore(dst, n, color);
+      } else {
+        _spanBlend(dst, n, color);
+      }
+    }
+    
+    // X where an edge crosses the horizontal line at y, always evaluated
+    // from its upper end so neighbouring triangles agree on shared edges
+    static inline float _edgeX(const Vertex *a, const Vertex *b, float y) {
+      if (b->y < a->y || (b->y == a->y && b->x < a->x)) { const Vertex *t = a; a = b; b = t; }
+      if (b->y == a->y) { return a->x; }
+      return a->x + (y - a->y) * (b->x - a->x) / (b->y - a->y);
+    }
+    
+    // Converting a float outside the int range is undefined, so values are
+    // limited to [lo, hi] first; NaN gives hi
+    static inline int _clampInt(float v, int lo, int hi) {
+      return v < (float)lo ? lo : v <= (float)hi ? (int)v : hi;
+    }
+    
+    static void _rasterTriangle(const Vertex *v0, const Vertex *v1, const Vertex *v2, const Surface *texture) {
+      Color color = v0->color;
+      const Vertex *t;
+      if (v1->y < v0->y) { t = v0; v0 = v1; v1 = t; }
+      if (v2->y < v0->y) { t = v0; v0 = v2; v2 = t; }
+      if (v2->y < v1->y) { t = v1; v1 = v2; v2 = t; }
+      
+      int y0 = _clampInt(ceilf(v0->y - 0.5f), clip.y0, clip.y1);
+      int y1 = _clampInt(ceilf(v2->y - 0.5f), clip.y0, clip.y1);
+      
+      // Texture coordinates are affine in screen space under the ortho projection
+      float dudx = 0, dudy = 0, dvdx = 0, dvdy = 0;
+      if (texture) {
+        float ax = v1->x - v0->x, ay = v1->y - v0->y;
+        float bx = v2->x - v0->x, by = v2->y - v0->y;
+        float det = ax * by - bx * ay;
+        if (det == 0.0f) { return; }
+        float au = v1->u - v0->u, bu = v2->u - v0->u;
+        float av = v1->v - v0->v, bv = v2->v - v0->v;
+        dudx = (au * by - bu * ay) / det;
+        dudy = (bu * ax - au * bx) / det;
+        dvdx = (av * by - bv * ay) / det;
+        dvdy = (bv * ax - av * bx) / det;
+      }
+      
+      for (int y = y0; y < y1; ++y) {
+        float sy = y + 0.5f;
+        float xa = _edgeX(v0, v2, sy);
+        float xb = sy < v1->y ? _edgeX(v0, v1, sy) : _edgeX(v1, v2, sy);
+        if (xb < xa) { float tx = xa; xa = xb; xb = tx; }
+        
+        int x0 = _clampInt(ceilf(xa - 0.5f), clip.x0, clip.x1);
+        int x1 = _clampInt(ceilf(xb - 0.5f), clip.x0, clip.x1);
+        
+        Color *row = framebuffer.pixels + y * framebuffer.w;
+        
+        if (!texture) {
+          _spanFill(row + x0, x1 - x0, color);
+          continue;
+        }
+        
+        for (int x = x0; x < x1; ++x) {
+          float dx = x + 0.5f - v0->x;
+          float dy = sy - v0->y;
+          int tx = _clampInt(floorf((v0->u + dudx * dx + dudy * dy) * texture->w), 0, texture->w - 1);
+          int ty = _clampInt(floorf((v0->v + dvdx * dx + dvdy * dy) * texture->h), 0, texture->h - 1);
+          
+          Color texel = texture->pixels[ty * texture->w + tx];
+          if (texel.a == 0) { continue; }
+          
+          Color c = {
+            _div255(texel.r * color.r), _div255(texel.g * color.g),
+            _div255(texel.b * color.b), _div255(texel.a * color.a),
+          };
+          row[x] = c.a == 255 ? c : _blend(row[x], c);
+        }
+      }
+    }
+    
+    // Steps along the major axis through the pixel centers in [start, end)
+    static void _rasterLine(const Vertex *v0, const Vertex *v1) {
+      Color color = v0->color;
+      float dx = v1->x - v0->x;
+      float dy = v1->y - v0->y;
+      int steep = fabsf(dy) > fabsf(dx);
+      
+      float a0 = steep ? v0->y : v0->x, a1 = steep ? v1->y : v1->x;
+      float b0 = steep ? v0->x : v0->y;
+      float slope = steep ? dx / dy : dy / dx;
+      int step = a1 < a0 ? -1 : 1;
+      
+      // Only the stretch of the major axis inside the clip is stepped, and
+      // the minor axis is kept just wide enough to still fail the test
+      int lo = steep ? clip.y0 : clip.x0, hi = steep ? clip.y1 : clip.x1;
+      int minor_lo = (steep ? clip.x0 : clip.y0) - 1, minor_hi = steep ? clip.x1 : clip.y1;
+      int i0 = step > 0 ? _clampInt(ceilf(a0 - 0.5f), lo, hi) : _clampInt(floorf(a0 - 0.5f), lo - 1, hi - 1);
+      int i1 = step > 0 ? _clampInt(ceilf(a1 - 0.5f), lo, hi) : _clampInt(floorf(a1 - 0.5f), lo - 1, hi - 1);
+      
+      for (int i = i0; step > 0 ? i < i1 : i > i1; i += step) {
+        int j = _clampInt(floorf(b0 + (i + 0.5f - a0) * slope), minor_lo, minor_hi);
+        int x = steep ? j : i;
+        int y = steep ? i : j;
+        if (x < clip.x0 || y < clip.y0 || x >= clip.x1 || y >= clip.y1) { continue; }
+        
+        Color *p = &framebuffer.pixels[y * framebuffer.w + x];
+        *p = color.a == 255 ? color : _blend(*p, color);
+      }
+    }
+  #endif
+  
+  static inline Rect _rectUnion(Rect a, Rect b) {
+    float x0 = fminf(a.x, b.x);
+    float y0 = fminf(a.y, b.y);
+    float x1 = fmaxf(a.x + a.w, b.x + b.w);
+    float y1 = fmaxf(a.y + a.h, b.y + b.h);
+    return (Rect){x0, y0, x1 - x0, y1 - y0};
+  }
+  
+  static inline int _rectTouches(Rect a, Rect b) {
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+  }
+  
+  static inline Rect _rectIntersect(Rect a, Rect b) {
+    float x0 = fmaxf(a.x, b.x);
+    float y0 = fmaxf(a.y, b.y);
+    float x1 = fminf(a.x + a.w, b.x + b.w);
+    float y1 = fminf(a.y + a.h, b.y + b.h);
+    return (Rect){x0, y0, fmaxf(x1 - x0, 0.0f), fmaxf(y1 - y0, 0.0f)};
+  }
+  
+  // --- CLIPPING --- //
+  // The user clip rectangle, when enabled, limits drawing and clearing on
+  // top of any damage region, and view is what shapes are culled against
+  Rect clip_rect;
+  int clip_enabled;
+  Rect view;
+  
+  // Set between layerBegin and layerEnd, which bypass damage and clipping
+  Layer *layer_target;
+  
+  // Limits rasterization to a pixel-aligned rectangle, kept inside the
+  // framebuffer, or the whole framebuffer for NULL. The GL backend uses the
+  // scissor test.
+  void _clipSet(const Rect *rect) {
+    #ifdef MINI_BACKEND_SOFTWARE
+      if (rect) {
+        clip.x0 = _clampInt(rect->x, 0, framebuffer.w);
+        clip.y0 = _clampInt(rect->y, 0, framebuffer.h);
+        clip.x1 = _clampInt(rect->x + rect->w, clip.x0, framebuffer.w);
+        clip.y1 = _clampInt(rect->y + rect->h, clip.y0, framebuffer.h);
+      } else {
+        clip = (Bounds){0, 0, framebuffer.w, framebuffer.h};
+      }
+    #else
+      if (rect) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor((int)rect->x, mini_window.h - (int)(rect->y + rect->h), (int)rect->w, (int)rect->h);
+      } else {
+        glDisable(GL_SCISSOR_TEST);
+      }
+    #endif
+  }
+  
+  // Clips to rect, or the window for NULL, narrowed by the user clip;
+  // returns 0 when nothing is left to draw
+  int _clipBegin(const Rect *rect) {
+    if (!rect && !clip_enabled) {
+      _clipSet(NULL);
+      return 1;
+    }
+    
+    Rect r = rect ? *rect : (Rect){0, 0, mini_window.w, mini_window.h};
+    if (clip_enabled) { r = _rectIntersect(r, clip_rect); }
+    if (r.w <= 0 || r.h <= 0) { return 0; }
+    
+    _clipSet(&r);
+    return 1;
+  }
+  
+  // --- DAMAGE --- //
+  // Callers invalidate what changed; a frame with no damage is neither
+  // drawn nor presented, and one with damage clears and draws only inside
+  // the damaged rectangles plus those of the frames still stale in the
+  // back buffer. The region is fixed by the first clear or flush of a frame.
+  #ifdef MINI_DAMAGE
+    typedef struct {
+      Rect rects[MINI_DAMAGE_RECTS];
+      int count;
+      // history[i] was presented i + 1 frames ago, the last slot is spare
+      Rect history[MINI_BUFFER_AGE][MINI_DAMAGE_RECTS];
+      int history_count[MINI_BUFFER_AGE];
+      Rect region[MINI_DAMAGE_RECTS];
+      int region_count;
+      int sealed;
+    } Damage;
+    
+    Damage damage;
+    
+    // Merges touching rectangles, and the cheapest pair once the list is full
+    void _damageAdd(Rect *list, int *count, Rect rect) {
+      for (int i = 0; i < *count; ++i) {
+        if (_rectTouches(list[i], rect)) {
+          rect = _rectUnion(list[i], rect);
+          list[i] = list[--*count];
+          i = -1;
+        }
+      }
+      
+      if (*count < MINI_DAMAGE_RECTS) {
+        list[(*count)++] = rect;
+        return;
+      }
+      
+      int best = 0;
+      float growth = INFINITY;
+      for (int i = 0; i < *count; ++i) {
+        Rect u = _rectUnion(list[i], rect);
+        float g = u.w * u.h - list[i].w * list[i].h;
+        if (g < growth) { growth = g; best = i; }
+      }
+      list[best] = _rectUnion(list[best], rect);
+    }
+    
+    void windowInvalidate(float x, float y, float w, float h) {
+      float x0 = fmaxf(floorf(x), 0.0f);
+      float y0 = fmaxf(floorf(y), 0.0f);
+      float x1 = fminf(ceilf(x + w), (float)mini_window.w);
+      float y1 = fminf(ceilf(y + h), (float)mini_window.h);
+      if (x1 <= x0 || y1 <= y0) { return; }
+      
+      _damageAdd(damage.rects, &damage.count, (Rect){x0, y0, x1 - x0, y1 - y0});
+    }
+    
+    void windowInvalidateAll() {
+      windowInvalidate(0, 0, mini_window.w, mini_window.h);
+    }
+    
+    // Clearing alone is not damage, only invalidating is
+    int windowDamaged() {
+      return damage.count > 0;
+    }
+    
+    void _damageSeal() {
+      if (damage.sealed) { return; }
+      
+      damage.region_count = 0;
+      for (int i = 0; i < damage.count; ++i) {
+        _damageAdd(damage.region, &damage.region_count, damage.rects[i]);
+      }
+      
+      if (damage.count > 0) {
+        for (int age = 0; age < MINI_BUFFER_AGE - 1; ++age) {
+          for (int i = 0; i < damage.history_count[age]; ++i) {
+            _damageAdd(damage.region, &damage.region_count, damage.history[age][i]);
+          }
+        }
+      }
+      
+      damage.sealed = 1;
+    }
+    
+    // Called after a frame that is not presented, so the next one seals anew
+    void _damageSkip() {
+      damage.region_count = 0;
+      damage.sealed = 0;
+    }
+    
+    // Called after a presented frame, which ages every back buffer by one
+    void _damageEnd() {
+      memmove(damage.history[1], damage.history[0], (MINI_BUFFER_AGE - 1) * sizeof(damage.history[0]));
+      memmove(&damage.history_count[1], &damage.history_count[0], (MINI_BUFFER_AGE - 1) * sizeof(int));
+      memcpy(damage.history[0], damage.rects, sizeof(damage.rects));
+      damage.history_count[0] = damage.count;
+      
+      damage.count = 0;
+      _damageSkip();
+    }
+  #endif
+  
+  #ifdef MINI_SDF
+    // --- SIGNED DISTANCE SHAPES --- //
+    // Coverage comes from the pixel's distance to the shape's edge, radial
+    // and angular, so edges are smooth at any size. u and v carry the
+    // offset from the centre.
+    typedef struct {
+      GLuint program;
+      int failed;
+    } Sdf;
+    
+    Sdf sdf;
+    
+    static int _sdfReady() {
+      if (sdf.program) { return 1; }
+      if (sdf.failed) { return 0; }
+      
+      const char *vertex =
+        "#version 120\n"
+        "attribute vec2 position;\n"
+        "attribute vec2 local;\n"
+        "attribute vec4 color;\n"
+        "attribute vec4 shape;\n"
+        "attribute float stroke;\n"
+        "varying vec2 offset;\n"
+        "varying vec4 params;\n"
+        "varying float width;\n"
+        "varying vec4 tint;\n"
+        "void main() {\n"
+        "  offset = local;\n"
+        "  params = shape;\n"
+        "  width = stroke;\n"
+        "  tint = color;\n"
+        "  gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+        "}\n";
+      const char *fragment =
+        "#version 120\n"
+        "varying vec2 offset;\n"
+        "varying vec4 params;\n"
+        "varying float width;\n"
+        "varying vec4 tint;\n"
+        "void main() {\n"
+        "  float d = length(offset);\n"
+        "  float dist = max(params.x - d, d - params.y);\n"
+        "  if (params.w < 1.0) {\n"
+        "    float t = fract(atan(offset.x, offset.y) / 6.2831853 - params.z);\n"
+        "    float arc = t < params.w ? -min(t, params.w - t) : min(t - params.w, 1.0 - t);\n"
+        "    dist = max(dist, arc * 6.2831853 * max(d, 0.5));\n"
+        "  }\n"
+        "  float cover = width > 0.0 ? 0.5 * width + 0.5 - abs(dist) : 0.5 - dist;\n"
+        "  gl_FragColor = vec4(tint.rgb, tint.a * clamp(cover, 0.0, 1.0));\n"
+        "}\n";
+      const char *attribs[] = {"position", "local", "color", "shape", "stroke"};
+      
+      sdf.program = _glProgram(vertex, fragment, attribs, 5);
+      sdf.failed = !sdf.program;
+      return sdf.program != 0;
+    }
+    
+    static void _sdfDraw() {
+      _glUseProgram(sdf.program);
+      glDisableClientState(GL_VERTEX_ARRAY);
+      glDisableClientState(GL_COLOR_ARRAY);
+      for (int i = 0; i < 5; ++i) { _glEnableVertexAttribArray(i); }
+      
+      _glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &batch.vertices[0].x);
+      _glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), &batch.vertices[0].u);
+      _glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), &batch.vertices[0].color);
+      _glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SdfParams), &batch.sdf[0].inner);
+      _glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(SdfParams), &batch.sdf[0].stroke);
+      glDrawArrays(GL_TRIANGLES, 0, batch.count);
+      
+      for (int i = 0; i < 5; ++i) { _glDisableVertexAttribArray(i); }
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glEnableClientState(GL_COLOR_ARRAY);
+      _glUseProgram(0);
+    }
+  #endif
+  
+  // --- BATCHING --- //
+  // Every shape is converted to GL_LINES or GL_TRIANGLES and appended to one
+  // client-side vertex array, which is drawn with a single glDrawArrays call
+  // when the primitive type or texture changes, the buffer is full or the
+  // frame ends.
+  void _batchDraw() {
+    #ifdef MINI_BACKEND_SOFTWARE
+      const Surface *texture = batch.texture ? &textures[batch.texture - 1] : NULL;
+      
+      if (batch.mode == GL_LINES) {
+        for (int i = 0; i + 1 < batch.count; i += 2) {
+          _rasterLine(&batch.vertices[i], &batch.vertices[i + 1]);
+        }
+      } else {
+        for (int i = 0; i + 2 < batch.count; i += 3) {
+          _rasterTriangle(&batch.vertices[i], &batch.vertices[i + 1], &batch.vertices[i + 2], texture);
+        }
+      }
+    #else
+      #ifdef MINI_SDF
+        if (batch.texture == MINI_TEXTURE_SDF) {
+          _sdfDraw();
+          return;
+        }
+      #endif
+      
+      if (batch.texture) {
+        glEnable(GL_TEXTURE_2D);
+        glEnable(GL_ALPHA_TEST);
+        glBindTexture(GL_TEXTURE_2D, batch.texture);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &batch.vertices[0].u);
+      }
+    
+      glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &batch.vertices[0].x);
+      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &batch.vertices[0].color);
+      glDrawArrays(batch.mode, 0, batch.count);
+    
+      if (batch.texture) {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_ALPHA_TEST);
+        glDisable(GL_TEXTURE_2D);
+      }
+    #endif
+  }
+  
+  // Runs draw once per damaged region, or once for the whole window,
+  // scissored to it and to the user clip
+  void _drawClipped(void (*draw)()) {
+    if (layer_target) {
+      draw();
+      return;
+    }
+    
+    #ifdef MINI_DAMAGE
+      _damageSeal();
+      for (int i = 0; i < damage.region_count; ++i) {
+        if (_clipBegin(&damage.region[i])) { draw(); }
+      }
+    #else
+      if (_clipBegin(NULL)) { draw(); }
+    #endif
+    _clipSet(NULL);
+  }
+  
+  static void _batchSubmit() {
+    if (batch.count == 0) { return; }
+    
+    PROFILE_BEGIN(PROFILE_FLUSH);
+    _drawClipped(_batchDraw);
+    
+    batch.frame.vertices += batch.count;
+    batch.frame.flushes++;
+    batch.count = 0;
+    
+    PROFILE_END(PROFILE_FLUSH);
+  }
+  
+  static inline Vertex *_batchReserve(int mode, unsigned int texture, int count) {
+    if (batch.mode != mode || batch.texture != texture || batch.count + count > MINI_BATCH_CAPACITY) {
+      _batchSubmit();
+      batch.mode = mode;
+      batch.texture = texture;
+    }
+    
+    Vertex *vertices = batch.vertices + batch.count;
+    batch.count += count;
+    return vertices;
+  }
+  
+  BatchStats batchStats() { return batch.last; }
+  
+  // --- COMMAND LISTS --- //
+  // While a thread records, every draw call on it tessellates into that
+  // thread's list instead of the batch, without touching GL. Vertices live
+  // in a chain of fixed-size blocks that is rewound, not freed, when the
+  // list is recorded again. Submitting copies the runs into the batch on
+  // the GL thread, in whatever order the lists are submitted.
+  struct CommandBlock {
+    CommandBlock *next;
+    int count;
+    Vertex vertices[MINI_COMMAND_BLOCK];
+  };
+  
+  MINI_THREAD_LOCAL CommandList *recording;
+  
+  void commandListBegin(CommandList *list) {
+    list->current = list->first;
+    if (list->current) { list->current->count = 0; }
+    list->count = 0;
+    list->drawn = 0;
+    list->culled = 0;
+    recording = list;
+  }
+  
+  void commandListEnd() {
+    recording = NULL;
+  }
+  
+  void commandListFree(CommandList *list) {
+    CommandBlock *block = list->first;
+    while (block) {
+      CommandBlock *next = block->next;
+      free(block);
+      block = next;
+    }
+    free(list->commands);
+    *list = (CommandList){0};
+  }
+  
+  static CommandBlock *_commandBlock(CommandList *list) {
+    CommandBlock *next = list->current ? list->current->next : list->first;
+    
+    if (!next) {
+      next = malloc(sizeof(CommandBlock));
+      if (!next) { exit(-1); }
+      next->next = NULL;
+      
+      if (list->current) {
+        list->current->next = next;
+      } else {
+        list->first = next;
+      }
+    }
+    
+    next->count = 0;
+    list->current = next;
+    return next;
+  }
+  
+  static Vertex *_commandReserve(CommandList *list, int mode, unsigned int texture, int count) {
+    CommandBlock *block = list->current;
+    if (!block || block->count + count > MINI_COMMAND_BLOCK) {
+      block = _commandBlock(list);
+    }
+    
+    Command *last = list->count ? &list->commands[list->count - 1] : NULL;
+    if (!last || last->mode != mode || last->texture != texture || last->block != block) {
+      if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->commands = realloc(list->commands, list->capacity * sizeof(Command));
+        if (!list->commands) { exit(-1); }
+      }
+      
+      last = &list->commands[list->count++];
+      *last = (Command){mode, texture, block, block->count, 0};
+    }
+    
+    Vertex *vertices = block->vertices + block->count;
+    block->count += count;
+    last->count += count;
+    return vertices;
+  }
+  
+  // --- DRAW QUEUE --- //
+  // With MINI_QUEUE, primitives are held back in frame memory as runs that
+  // share a depth and a state, the primitive type and texture, until the
+  // next flush. The runs are then radix sorted by depth, pass and state. A
+  // run's pass is the lowest that keeps it after every earlier run of the
+  // same depth it overlaps: equal to theirs when the state matches, one
+  // more when it does not. Overlap is found on a coarse grid over the view,
+  // so runs that do not touch are free to join others of their state.
+  #ifdef MINI_QUEUE
+    #ifndef MINI_QUEUE_BLOCK
+      #define MINI_QUEUE_BLOCK 16384
+    #endif
+    
+    #ifndef MINI_QUEUE_CELL
+      #define MINI_QUEUE_CELL 64
+    #endif
+    
+    typedef struct {
+      Vertex *vertices;
+      #ifdef MINI_SDF
+        SdfParams *sdf;
+      #endif
+      int count;
+      int depth;
+      int state;
+    } QueueRun;
+    
+    typedef struct {
+      int mode;
+      unsigned int texture;
+    } QueueState;
+    
+    // Highest pass drawn over a cell at depth, and its state or -1 when
+    // runs of several states share that pass
+    typedef struct {
+      int depth;
+      int pass;
+      int state;
+    } QueueCell;
+    
+    // depth is offset by 32768 so it sorts as unsigned
+    typedef struct {
+      int depth;
+      QueueRun *runs;
+      int count;
+      int capacity;
+      QueueState *states;
+      int state_count;
+      int state_capacity;
+      Vertex *block;
+      int used;
+      int size;
+      #ifdef MINI_SDF
+        SdfParams *sdf;
+        SdfParams *params;
+      #endif
+    } Queue;
+    
+    Queue queue = {.depth = 32768};
+    
+    #define QUEUE_USES(texture) _queueUses(texture)
+    #define QUEUE_FRAME() (queue = (Queue){.depth = queue.depth})
+    
+    // Shapes drawn at a higher depth cover lower ones
+    void drawDepth(int depth) {
+      TRACE_ARGS(TRACE_OP_DEPTH, 0, depth);
+      depth = depth < -32768 ? -32768 : depth > 32767 ? 32767 : depth;
+      queue.depth = depth + 32768;
+    }
+    
+    static int _queueUses(unsigned int texture) {
+      for (int i = 0; i < queue.state_count; ++i) {
+        if (queue.states[i].texture == texture) { return 1; }
+      }
+      return 0;
+    }
+    
+    static int _queueState(int mode, unsigned int texture) {
+      for (int i = queue.state_count - 1; i >= 0; --i) {
+        if (queue.states[i].mode == mode && queue.states[i].texture == texture) { return i; }
+      }
+      
+      if (queue.state_count == queue.state_capacity) {
+        queue.state_capacity = queue.state_capacity ? queue.state_capacity * 2 : 16;
+        QueueState *states = frameAlloc(queue.state_capacity * sizeof(QueueState));
+        if (queue.state_count) { memcpy(states, queue.states, queue.state_count * sizeof(QueueState)); }
+        queue.states = states;
+      }
+      queue.states[queue.state_count] = (QueueState){mode, texture};
+      return queue.state_count++;
+    }
+    
+    static Vertex *_queueReserve(int mode, unsigned int texture, int count) {
+      if (!queue.block || queue.used + count > queue.size) {
+        queue.size = count > MINI_QUEUE_BLOCK ? count : MINI_QUEUE_BLOCK;
+        queue.block = frameAlloc(queue.size * sizeof(Vertex));
+        queue.used = 0;
+        #ifdef MINI_SDF
+          queue.sdf = NULL;
+        #endif
+      }
+      
+      Vertex *vertices = queue.block + queue.used;
+      QueueRun *last = queue.count ? &queue.runs[queue.count - 1] : NULL;
+      const QueueState *state = last ? &queue.states[last->state] : NULL;
+      
+      if (!last || last->depth != queue.depth || state->mode != mode || state->texture != texture || last->vertices + last->count != vertices) {
+        if (queue.count == queue.capacity) {
+          queue.capacity = queue.capacity ? queue.capacity * 2 : 256;
+          QueueRun *runs = frameAlloc(queue.capacity * sizeof(QueueRun));
+          if (queue.count) { memcpy(runs, queue.runs, queue.count * sizeof(QueueRun)); }
+          queue.runs = runs;
+        }
+        
+        last = &queue.runs[queue.count++];
+        *last = (QueueRun){.vertices = vertices, .depth = queue.depth, .state = _queueState(mode, texture)};
+        
+        #ifdef MINI_SDF
+          if (texture == MINI_TEXTURE_SDF) {
+            if (!queue.sdf) { queue.sdf = frameAlloc(queue.size * sizeof(SdfParams)); }
+            last->sdf = queue.sdf + queue.used;
+          }
+        #endif
+      }
+      
+      #ifdef MINI_SDF
+        if (last->sdf) { queue.params = last->sdf + last->count; }
+      #endif
+      
+      last->count += count;
+      queue.used += count;
+      return vertices;
+    }
+    
+    // Stable LSD sort of order by bits [from, to) of keys, a byte at a
+    // time, skipping bytes every key shares. Returns the sorted array,
+    // which is either order or tmp.
+    static int *_queueSort(int *order, int *tmp, const unsigned long long *keys, int n, int from, int to) {
+      for (int shift = from; shift < to; shift += 8) {
+        int counts[256] = {0};
+        for (int i = 0; i < n; ++i) { counts[(keys[order[i]] >> shift) & 0xFF]++; }
+        if (counts[(keys[order[0]] >> shift) & 0xFF] == n) { continue; }
+        
+        for (int i = 0, sum = 0; i < 256; ++i) {
+          int c = counts[i];
+          counts[i] = sum;
+          sum += c;
+        }
+        for (int i = 0; i < n; ++i) { tmp[counts[(keys[order[i]] >> shift) & 0xFF]++] = order[i]; }
+        
+        int *swap = order;
+        order = tmp;
+        tmp = swap;
+      }
+      return order;
+    }
+    
+    // Takes runs in depth order, call order within a depth, and adds each
+    // one's pass and state to its key
+    static void _queuePasses(const int *order, int n, unsigned long long *keys) {
+      int gw = (int)ceilf(view.w / MINI_QUEUE_CELL);
+      int gh = (int)ceilf(view.h / MINI_QUEUE_CELL);
+      gw = gw < 1 ? 1 : gw;
+      gh = gh < 1 ? 1 : gh;
+      
+      QueueCell *grid = frameAlloc(gw * gh * sizeof(QueueCell));
+      for (int i = 0; i < gw * gh; ++i) { grid[i].depth = -1; }
+      
+      for (int k = 0; k < n; ++k) {
+        const QueueRun *run = &queue.runs[order[k]];
+        
+        // Widened by a pixel for lines and antialiased edges
+        float x0 = run->vertices[0].x, y0 = run->vertices[0].y, x1 = x0, y1 = y0;
+        for (int i = 1; i < run->count; ++i) {
+          x0 = fminf(x0, run->vertices[i].x);
+          y0 = fminf(y0, run->vertices[i].y);
+          x1 = fmaxf(x1, run->vertices[i].x);
+          y1 = fmaxf(y1, run->vertices[i].y);
+        }
+        
+        int cx0 = (int)floorf((x0 - 1.0f - view.x) / MINI_QUEUE_CELL);
+        int cy0 = (int)floorf((y0 - 1.0f - view.y) / MINI_QUEUE_CELL);
+        int cx1 = (int)floorf((x1 + 1.0f - view.x) / MINI_QUEUE_CELL);
+        int cy1 = (int)floorf((y1 + 1.0f - view.y) / MINI_QUEUE_CELL);
+        cx0 = cx0 < 0 ? 0 : cx0 >= gw ? gw - 1 : cx0;
+        cy0 = cy0 < 0 ? 0 : cy0 >= gh ? gh - 1 : cy0;
+        cx1 = cx1 < 0 ? 0 : cx1 >= gw ? gw - 1 : cx1;
+        cy1 = cy1 < 0 ? 0 : cy1 >= gh ? gh - 1 : cy1;
+        
+        int pass = 0;
+        for (int y = cy0; y <= cy1; ++y) {
+          for (int x = cx0; x <= cx1; ++x) {
+            const QueueCell *cell = &grid[y * gw + x];
+            if (cell->depth != run->depth) { continue; }
+            int needed = cell->pass + (cell->state != run->state);
+            pass = needed > pass ? needed : pass;
+          }
+        }
+        
+        for (int y = cy0; y <= cy1; ++y) {
+          for (int x = cx0; x <= cx1; ++x) {
+            QueueCell *cell = &grid[y * gw + x];
+            if (cell->depth != run->depth || pass > cell->pass) {
+              *cell = (QueueCell){run->depth, pass, run->state};
+            } else if (pass == cell->pass && cell->state != run->state) {
+              cell->state = -1;
+            }
+          }
+        }
+        
+        keys[order[k]] |= (unsigned long long)pass << 20 | (unsigned long long)run->state;
+      }
+    }
+    
+    static void _queueDrain() {
+      int n = queue.count;
+      if (n == 0) { return; }
+      
+      unsigned long long *keys = frameAlloc(n * sizeof(unsigned long long));
+      int *a = frameAlloc(n * sizeof(int));
+      int *b = frameAlloc(n * sizeof(int));
+      
+      // Key bits: depth 48-63, pass 20-47, state 0-19
+      for (int i = 0; i < n; ++i) {
+        keys[i] = (unsigned long long)queue.runs[i].depth << 48;
+        a[i] = i;
+      }
+      int *order = _queueSort(a, b, keys, n, 48, 64);
+      _queuePasses(order, n, keys);
+      order = _queueSort(order, order == a ? b : a, keys, n, 0, 64);
+      
+      // Whole lines and triangles per chunk
+      const int chunk = MINI_BATCH_CAPACITY / 6 * 6;
+      int before = 0, after = 0;
+      
+      for (int k = 0; k < n; ++k) {
+        const QueueRun *run = &queue.runs[order[k]];
+        const QueueState *state = &queue.states[run->state];
+        before += k > 0 && queue.runs[k].state != queue.runs[k - 1].state;
+        after += k > 0 && run->state != queue.runs[order[k - 1]].state;
+        
+        for (int done = 0; done < run->count; done += chunk) {
+          int count = run->count - done < chunk ? run->count - done : chunk;
+          memcpy(_batchReserve(state->mode, state->texture, count), run->vertices + done, count * sizeof(Vertex));
+          #ifdef MINI_SDF
+            if (run->sdf) { memcpy(&batch.sdf[batch.count - count], run->sdf + done, count * sizeof(SdfParams)); }
+          #endif
+        }
+      }
+      batch.frame.saved += before - after;
+      
+      // Everything was copied out, so the block is reused
+      queue.count = 0;
+      queue.state_count = 0;
+      queue.used = 0;
+    }
+  #else
+    #define QUEUE_USES(texture) 0
+    #define QUEUE_FRAME()
+  #endif
+  
+  void batchFlush() {
+    #ifdef MINI_QUEUE
+      _queueDrain();
+    #endif
+    _batchSubmit();
+  }
+  
+  // Reserves room for one primitive, so a flush never splits it
+  static inline Vertex *_batchBegin(int mode, unsigned int texture, int count) {
+    if (recording) {
+      return _commandReserve(recording, mode, texture, count);
+    }
+    
+    #ifdef MINI_QUEUE
+      return _queueReserve(mode, texture, count);
+    #else
+      return _batchReserve(mode, texture, count);
+    #endif
+  }
+  
+  void commandListSubmit(const CommandList *list) {
+    // Whole lines and triangles per chunk
+    const int chunk = MINI_BATCH_CAPACITY / 6 * 6;
+    
+    batch.frame.drawn += list->drawn;
+    batch.frame.culled += list->culled;
+    
+    for (int i = 0; i < list->count; ++i) {
+      const Command *command = &list->commands[i];
+      const Vertex *src = command->block->vertices + command->start;
+      
+      for (int done = 0; done < command->count; done += chunk) {
+        int n = command->count - done < chunk ? command->count - done : chunk;
+        memcpy(_batchBegin(command->mode, command->texture, n), src + done, n * sizeof(Vertex));
+      }
+    }
+  }
+  
+  static inline void _batchLine(float x0, float y0, float x1, float y1, Color color) {
+    Vertex *v = _batchBegin(GL_LINES, 0, 2);
+    v[0] = (Vertex){x0, y0, 0.0f, 0.0f, color};
+    v[1] = (Vertex){x1, y1, 0.0f, 0.0f, color};
+  }
+  
+  static inline void _batchTriangle(float x0, float y0, float x1, float y1, float x2, float y2, Color color) {
+    Vertex *v = _batchBegin(GL_TRIANGLES, 0, 3);
+    v[0] = (Vertex){x0, y0, 0.0f, 0.0f, color};
+    v[1] = (Vertex){x1, y1, 0.0f, 0.0f, color};
+    v[2] = (Vertex){x2, y2, 0.0f, 0.0f, color};
+  }
+  
+  static inline void _batchQuad(unsigned int texture, float x, float y, float w, float h, float u0, float v0, float u1, float v1, Color color) {
+    Vertex *v = _batchBegin(GL_TRIANGLES, texture, 6);
+    v[0] = (Vertex){x, y, u0, v0, color};
+    v[1] = (Vertex){x + w, y, u1, v0, color};
+    v[2] = (Vertex){x + w, y + h, u1, v1, color};
+    v[3] = (Vertex){x, y, u0, v0, color};
+    v[4] = (Vertex){x + w, y + h, u1, v1, color};
+    v[5] = (Vertex){x, y + h, u0, v1, color};
+  }
+  
+  #ifdef MINI_SDF
+    // Angles in degrees as everywhere else. Returns 0 when the shader is
+    // unavailable or the thread is recording, and the caller tessellates.
+    static int _batchSdf(float x, float y, float inner, float outer, float start, float end, float stroke, Color color) {
+      if (recording || !_sdfReady()) { return 0; }
+      
+      float sweep = (end - start) / 360.0f;
+      if (sweep < 0.0f) {
+        start = end;
+        sweep = -sweep;
+      }
+      start /= 360.0f;
+      
+      float e = outer + stroke * 0.5f + 1.0f;
+      _batchQuad(MINI_TEXTURE_SDF, x - e, y - e, e * 2, e * 2, -e, -e, e, e, color);
+      
+      #ifdef MINI_QUEUE
+        SdfParams *p = queue.params;
+      #else
+        SdfParams *p = &batch.sdf[batch.count - 6];
+      #endif
+      for (int i = 0; i < 6; ++i) {
+        p[i] = (SdfParams){inner, outer, start - floorf(start), sweep, stroke};
+      }
+      return 1;
+    }
+  #endif
+  
+  // --- CULLING --- //
+  // Shapes whose bounds miss the view are dropped before tessellation
+  static inline int _visible(float x0, float y0, float x1, float y1) {
+    int visible = x1 >= view.x && y1 >= view.y && x0 <= view.x + view.w && y0 <= view.y + view.h;
+    
+    if (recording) {
+      recording->drawn += visible;
+      recording->culled += !visible;
+    } else {
+      batch.frame.drawn += visible;
+      batch.frame.culled += !visible;
+    }
+    return visible;
+  }
+  
+  static void _viewUpdate() {
+    Rect window = {0, 0, mini_window.w, mini_window.h};
+    view = clip_enabled ? _rectIntersect(window, clip_rect) : window;
+  }
+  
+  // Limits drawing, clearing and culling to a rectangle until clipReset
+  void clipSet(float x, float y, float w, float h) {
+    if (recording) { return; }
+    TRACE_ARGS(TRACE_OP_CLIP, 0, x, y, w, h);
+    batchFlush();
+    clip_rect = (Rect){floorf(x), floorf(y), ceilf(x + w) - floorf(x), ceilf(y + h) - floorf(y)};
+    clip_enabled = 1;
+    _viewUpdate();
+  }
+  
+  void clipReset() {
+    if (recording) { return; }
+    TRACE_DATA(TRACE_OP_CLIP_RESET, 0, NULL, 0, NULL, 0, NULL, 0);
+    batchFlush();
+    clip_enabled = 0;
+    _viewUpdate();
+  }
+  
+  // --- TEXTURES --- //
+  // Texels are RGBA8 and sampled with nearest filtering, so pixel art such
+  // as the font atlas stays crisp at any scale.
+  unsigned int _textureCreate(int w, int h, const unsigned char *pixels) {
+    #ifdef MINI_BACKEND_SOFTWARE
+      // Slots of freed textures are reused
+      int slot = 0;
+      while (slot < texture_count && textures[slot].pixels) { slot++; }
+      if (slot == MINI_SOFTWARE_TEXTURES) { return 0; }
+      
+      Surface *texture = &textures[slot];
+      texture->pixels = malloc(w * h * sizeof(Color));
+      if (!texture->pixels) { return 0; }
+      
+      if (pixels) {
+        memcpy(texture->pixels, pixels, w * h * sizeof(Color));
+      } else {
+        memset(texture->pixels, 0, w * h * sizeof(Color));
+      }
+      texture->w = w;
+      texture->h = h;
+      if (slot == texture_count) { texture_count++; }
+      return slot + 1;
+    #else
+      GLuint id;
+      glGenTextures(1, &id);
+      glBindTexture(GL_TEXTURE_2D, id);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+      return id;
+    #endif
+  }
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    GLuint upload_buffers[MINI_UPLOAD_BUFFERS];
+    int upload_next;
+  #endif
+  
+  // Each pixel buffer is orphaned before it is filled, so the copy never
+  // waits on the GPU still reading an earlier upload, and glTexSubImage2D
+  // only queues the transfer. Without pixel buffers the upload is direct.
+  static void _textureWrite(unsigned int id, int x, int y, int w, int h, const unsigned char *pixels) {
+    // Quads already batched with this texture must see the old texels
+    if (batch.texture == id || QUEUE_USES(id)) { batchFlush(); }
+    
+    #ifdef MINI_BACKEND_SOFTWARE
+      Surface *texture = &textures[id - 1];
+      for (int row = 0; row < h; ++row) {
+        memcpy(texture->pixels + (y + row) * texture->w + x, pixels + (size_t)row * w * sizeof(Color), w * sizeof(Color));
+      }
+    #else
+      glBindTexture(GL_TEXTURE_2D, id);
+      
+      if (_glMapBuffer) {
+        if (!upload_buffers[0]) { _glGenBuffers(MINI_UPLOAD_BUFFERS, upload_buffers); }
+        
+        size_t size = (size_t)w * h * sizeof(Color);
+        _glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_buffers[upload_next]);
+        upload_next = (upload_next + 1) % MINI_UPLOAD_BUFFERS;
+        _glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        
+        void *mapped = _glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (mapped) {
+          memcpy(mapped, pixels, size);
+          _glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+          glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+          _glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+          return;
+        }
+        _glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      }
+      
+      glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    #endif
+  }
+  
+  Texture textureLoad(const unsigned char *rgba, int w, int h) {
+    if (w <= 0 || h <= 0) { return (Texture){0}; }
+    
+    unsigned int id = _textureCreate(w, h, rgba);
+    return id ? (Texture){id, w, h} : (Texture){0};
+  }
+  
+  void textureUpdate(Texture texture, const unsigned char *rgba) {
+    textureUpdateRegion(texture, 0, 0, texture.w, texture.h, rgba);
+  }
+  
+  void textureUpdateRegion(Texture texture, int x, int y, int w, int h, const unsigned char *rgba) {
+    if (!texture.id || w <= 0 || h <= 0 || x < 0 || y < 0 || x + w > texture.w || y + h > texture.h) { return; }
+    _textureWrite(texture.id, x, y, w, h, rgba);
+  }
+  
+  void textureFree(Texture *texture) {
+    if (texture->id) {
+      if (batch.texture == texture->id || QUEUE_USES(texture->id)) { batchFlush(); }
+      
+      #ifdef MINI_BACKEND_SOFTWARE
+        Surface *surface = &textures[texture->id - 1];
+        free(surface->pixels);
+        *surface = (Surface){0};
+        while (texture_count > 0 && !textures[texture_count - 1].pixels) { texture_count--; }
+      #else
+        glDeleteTextures(1, &texture->id);
+      #endif
+    }
+    *texture = (Texture){0};
+  }
+  
+  // --- ATLAS --- //
+  // Skyline bottom-left packing: each image goes where its top edge ends
+  // up lowest, resting on the highest skyline segment below it. The
+  // skyline only rises, so gaps under overhangs are not reused, which
+  // keeps adding an image linear in the number of segments.
+  int atlasInit(Atlas *atlas, int w, int h) {
+    *atlas = (Atlas){0};
+    atlas->texture = textureLoad(NULL, w, h);
+    if (!atlas->texture.id) { return 0; }
+    
+    // Segments start at distinct columns, so there are at most w of them
+    atlas->skyline = malloc(w * sizeof(Vec2));
+    if (!atlas->skyline) { exit(-1); }
+    atlas->skyline[0] = (Vec2){0, 0};
+    atlas->nodes = 1;
+    return 1;
+  }
+  
+  // Height the image would rest at with its left edge on segment i, or -1
+  static int _atlasFit(const Atlas *atlas, int i, int w, int h) {
+    int x = atlas->skyline[i].x;
+    if (x + w > atlas->texture.w) { return -1; }
+    
+    // Spans the padding too, since atlasAdd raises the skyline over it
+    int right = x + w + MINI_ATLAS_PADDING;
+    if (right > atlas->texture.w) { right = atlas->texture.w; }
+    
+    int y = 0;
+    for (int j = i; j < atlas->nodes && atlas->skyline[j].x < right; ++j) {
+      if (atlas->skyline[j].y > y) { y = atlas->skyline[j].y; }
+    }
+    return y + h <= atlas->texture.h ? y : -1;
+  }
+  
+  int atlasAdd(Atlas *atlas, const unsigned char *rgba, int w, int h, Sprite *sprite) {
+    if (!atlas->texture.id || w <= 0 || h <= 0) { return 0; }
+    
+    int best = -1;
+    int best_y = 0;
+    for (int i = 0; i < atlas->nodes; ++i) {
+      int y = _atlasFit(atlas, i, w, h);
+      if (y >= 0 && (best < 0 || y < best_y)) {
+        best = i;
+        best_y = y;
+      }
+    }
+    if (best < 0) { return 0; }
+    
+    Vec2 *skyline = atlas->skyline;
+    int x = skyline[best].x;
+    int right = x + w + MINI_ATLAS_PADDING;
+    if (right > atlas->texture.w) { right = atlas->texture.w; }
+    int top = best_y + h + MINI_ATLAS_PADDING;
+    
+    // Segments starting under the image are replaced by its top edge; the
+    // last of them continues past the right edge at its old height
+    int end = best;
+    while (end < atlas->nodes && skyline[end].x < right) { end++; }
+    int next = end < atlas->nodes ? skyline[end].x : atlas->texture.w;
+    int tail = right < next;
+    Vec2 rest = {right, skyline[end - 1].y};
+    
+    int count = 1 + tail;
+    memmove(&skyline[best + count], &skyline[end], (atlas->nodes - end) * sizeof(Vec2));
+    atlas->nodes += count - (end - best);
+    skyline[best] = (Vec2){x, top};
+    if (tail) { skyline[best + 1] = rest; }
+    
+    // Neighbours at the same height become one segment
+    int n = 0;
+    for (int i = 0; i < atlas->nodes; ++i) {
+      if (n > 0 && skyline[n - 1].y == skyline[i].y) { continue; }
+      skyline[n++] = skyline[i];
+    }
+    atlas->nodes = n;
+    
+    _textureWrite(atlas->texture.id, x, best_y, w, h, rgba);
+    *sprite = (Sprite){atlas->texture, x, best_y, w, h};
+    return 1;
+  }
+  
+  void atlasFree(Atlas *atlas) {
+    textureFree(&atlas->texture);
+    free(atlas->skyline);
+    *atlas = (Atlas){0};
+  }
+  
+  #ifdef MINI_PICKING
+    #include "./addons/minipicking.h"
+  #else
+    #define PICK_RECT(x0, y0, x1, y1)
+    #define PICK_POLYGON(points, count)
+    #define PICK_SECTOR(x, y, inner, outer, start, end)
+    #define PICK_FRAME()
+  #endif
+  
+  // --- SPRITES --- //
+  // Sprites of one texture share a batch, so a whole atlas of them draws
+  // in a single call.
+  void drawSpriteRegion(const Sprite *sprite, Rect source, Rect dest, Color color) {
+    if (!_visible(fminf(dest.x, dest.x + dest.w), fminf(dest.y, dest.y + dest.h), fmaxf(dest.x, dest.x + dest.w), fmaxf(dest.y, dest.y + dest.h))) { return; }
+    PICK_RECT(fminf(dest.x, dest.x + dest.w), fminf(dest.y, dest.y + dest.h), fmaxf(dest.x, dest.x + dest.w), fmaxf(dest.y, dest.y + dest.h));
+    
+    float tw = sprite->texture.w;
+    float th = sprite->texture.h;
+    float u0 = (sprite->x + source.x) / tw;
+    float v0 = (sprite->y + source.y) / th;
+    float u1 = (sprite->x + source.x + source.w) / tw;
+    float v1 = (sprite->y + source.y + source.h) / th;
+    _batchQuad(sprite->texture.id, dest.x, dest.y, dest.w, dest.h, u0, v0, u1, v1, color);
+  }
+  
+  void drawSprite(const Sprite *sprite, float x, float y, Color color) {
+    Rect source = {0, 0, sprite->w, sprite->h};
+    drawSpriteRegion(sprite, source, (Rect){x, y, sprite->w, sprite->h}, color);
+  }
+  
+  // --- LAYERS --- //
+  // Drawing between layerBegin and layerEnd goes to the layer's own
+  // framebuffer instead of the window, and layerBegin skips it entirely
+  // while the layer is valid. The GL backend renders into a framebuffer
+  // object; without one, layers are drawn straight to the window every
+  // frame and layerDraw does nothing.
+  #ifdef MINI_BACKEND_SOFTWARE
+    Surface layer_saved;
+    const Layer *layer_blit;
+    int layer_x;
+    int layer_y;
+    
+    // Premultiplied source over destination
+    static void _layerBlit() {
+      const Layer *layer = layer_blit;
+      int ox = layer_x, oy = layer_y;
+      int x0 = ox > clip.x0 ? ox : clip.x0, x1 = ox + layer->w < clip.x1 ? ox + layer->w : clip.x1;
+      int y0 = oy > clip.y0 ? oy : clip.y0, y1 = oy + layer->h < clip.y1 ? oy + layer->h : clip.y1;
+      
+      for (int y = y0; y < y1; ++y) {
+        const Color *src = &layer->pixels[(y - oy) * layer->w + (x0 - ox)];
+        Color *dst = &framebuffer.pixels[y * framebuffer.w];
+        for (int x = x0; x < x1; ++x) {
+          Color s = src[x - x0];
+          if (s.a == 255) {
+            dst[x] = s;
+          } else if (s.a || s.r || s.g || s.b) {
+            unsigned int ia = 255 - s.a;
+            dst[x] = (Color){
+              s.r + _div255(dst[x].r * ia), s.g + _div255(dst[x].g * ia),
+              s.b + _div255(dst[x].b * ia), s.a + _div255(dst[x].a * ia),
+            };
+          }
+        }
+      }
+    }
+  #endif
+  
+  void layerFree(Layer *layer) {
+    #ifdef MINI_BACKEND_SOFTWARE
+      free(layer->pixels);
+    #else
+      if (layer->framebuffer) { _glDeleteFramebuffers(1, &layer->framebuffer); }
+      if (layer->texture) { glDeleteTextures(1, &layer->texture); }
+    #endif
+    *layer = (Layer){0};
+  }
+  
+  void layerInvalidate(Layer *layer) { layer->valid = 0; }
+  
+  int layerBegin(Layer *layer, int w, int h) {
+    if (recording) { return 0; }
+    if (layer->valid && layer->w == w && layer->h == h) { return 0; }
+    
+    batchFlush();
+    if (layer->w != w || layer->h != h) { layerFree(layer); }
+    layer->w = w;
+    layer->h = h;
+    
+    #ifdef MINI_BACKEND_SOFTWARE
+      if (!layer->pixels) {
+        layer->pixels = malloc(w * h * sizeof(Color));
+        if (!layer->pixels) { exit(-1); }
+      }
+      memset(layer->pixels, 0, w * h * sizeof(Color));
+      
+      layer_saved = framebuffer;
+      framebuffer = (Surface){layer->pixels, w, h};
+    #else
+      if (!layer->framebuffer && _glGenFramebuffers) {
+        layer->texture = _textureCreate(w, h, NULL);
+        _glGenFramebuffers(1, &layer->framebuffer);
+        _glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+        _glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer->texture, 0);
+        if (_glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+          _glBindFramebuffer(GL_FRAMEBUFFER, 0);
+          layerFree(layer);
+          layer->w = w;
+          layer->h = h;
+        }
+      }
+      if (!layer->framebuffer) { return 1; }
+      
+      GLfloat clear[4];
+      glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+      _glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+      glViewport(0, 0, w, h);
+      _resize(w, h);
+      glClearColor(0, 0, 0, 0);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glClearColor(clear[0], clear[1], clear[2], clear[3]);
+    #endif
+    
+    layer_target = layer;
+    _clipSet(NULL);
+    view = (Rect){0, 0, w, h};
+    return 1;
+  }
+  
+  void layerEnd() {
+    if (recording || !layer_target) { return; }
+    
+    batchFlush();
+    #ifdef MINI_BACKEND_SOFTWARE
+      framebuffer = layer_saved;
+    #else
+      _glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glViewport(0, 0, mini_window.w, mini_window.h);
+      _resize(mini_window.w, mini_window.h);
+    #endif
+    
+    layer_target->valid = 1;
+    layer_target = NULL;
+    _clipSet(NULL);
+    _viewUpdate();
+  }
+  
+  void layerDraw(const Layer *layer, float x, float y) {
+    if (recording || !layer->valid || !_visible(x, y, x + layer->w, y + layer->h)) { return; }
+    
+    batchFlush();
+    #ifdef MINI_BACKEND_SOFTWARE
+      layer_blit = layer;
+      layer_x = (int)floorf(x + 0.5f);
+      layer_y = (int)floorf(y + 0.5f);
+      _drawClipped(_layerBlit);
+    #else
+      glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      _batchQuad(layer->texture, x, y, layer->w, layer->h, 0.0f, 1.0f, 1.0f, 0.0f, colorRGBA(255, 255, 255, 255));
+      batchFlush();
+      if (_glBlendFuncSeparate) {
+        _glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      } else {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      }
+    #endif
+  }
+  
+  #ifdef MINI_FONTS
+    #include "./addons/minifonts.h"
+  #endif
+  
+  #ifdef MINI_CAPTURE
+    #include "./addons/minicapture.h"
+  #endif
+  
+  #ifdef MINI_PARTICLES
+    #include "./addons/miniparticles.h"
+  #endif
+  
+  #ifdef MINI_TILEMAP
+    #include "./addons/minitilemap.h"
+  #endif
+  
+  // --- PROFILER OVERLAY --- //
+  #if defined(MINI_PROFILER) && defined(MINI_FONTS)
+    void drawProfiler(float x, float y) {
+      ProfileFrame frame = profiler.last;
+      Color text = colorRGB(0xFF, 0xFF, 0xFF);
+      char line[160];
+      
+      snprintf(line, sizeof(line),
+        "%.1f fps  %.2f ms\n"
+        "p50 %.1f ms  p99 %.1f ms\n"
+        "draw %.2f  flush %.2f\n"
+        "swap %.2f  sleep %.2f\n"
+        "events %.2f\n"
+        "calls %d  vertices %d",
+        frame.time > 0.0 ? 1.0 / frame.time : 0.0, frame.time * 1000.0,
+        profilePercentile(0.5) * 1000.0, profilePercentile(0.99) * 1000.0,
+        frame.phases[PROFILE_DRAW] * 1000.0, frame.phases[PROFILE_FLUSH] * 1000.0,
+        frame.phases[PROFILE_SWAP] * 1000.0, frame.phases[PROFILE_SLEEP] * 1000.0,
+        frame.phases[PROFILE_EVENTS] * 1000.0,
+        frame.calls, frame.vertices);
+      
+      Vec2 size = measureText(line, 1);
+      int graph = 40;
+      float w = size.x > MINI_PROFILER_FRAMES ? size.x : MINI_PROFILER_FRAMES;
+      
+      drawRectangleFilled(x, y, w + 8, size.y + graph + 12, colorRGBA(0, 0, 0, 0xC0));
+      drawText(line, x + 4, y + 4, 1, text);
+      
+      // One bar per recent frame, oldest on the left, scaled to 33 ms
+      float base = y + size.y + graph + 8;
+      for (int i = 0; i < profiler.count; ++i) {
+        int index = (profiler.head - profiler.count + i + MINI_PROFILER_FRAMES) % MINI_PROFILER_FRAMES;
+        double t = profiler.times[index];
+        float h = (float)(t / 0.033 * graph);
+        if (h > graph) { h = graph; }
+        
+        Color color = t > 1.0 / 59.0 ? colorRGB(0xE0, 0x40, 0x40) : colorRGB(0x40, 0xE0, 0x40);
+        drawRectangleFilled(x + 4 + i, base - h, 1, h, color);
+      }
+    }
+  #endif
+  
+  // --- TRIGONOMETRY --- //
+  // One turn of sin plus a quarter turn, so cos is the same table read a
+  // quarter turn further. Shared by every curved primitive.
+  float trig_table[MINI_TRIG_SIZE + MINI_TRIG_SIZE / 4 + 2];
+  
+  void _trigInit() {
+    for (int i = 0; i < MINI_TRIG_SIZE + MINI_TRIG_SIZE / 4 + 2; ++i) {
+      trig_table[i] = sin(i * TAU / MINI_TRIG_SIZE);
+    }
+  }
+  
+  // Unit vector at an angle in turns (1.0 = 360 degrees). A non-finite
+  // angle reads as 0 rather than indexing outside the table.
+  static inline void _unit(float turns, float *s, float *c) {
+    float t = (turns - floorf(turns)) * MINI_TRIG_SIZE;
+    if (!(t >= 0.0f)) { t = 0.0f; }
+    int i = (int)t;
+    float f = t - i;
+    
+    *s = trig_table[i] + (trig_table[i + 1] - trig_table[i]) * f;
+    i += MINI_TRIG_SIZE / 4;
+    *c = trig_table[i] + (trig_table[i + 1] - trig_table[i]) * f;
+  }
+  
+  // Segments needed to keep a curve of radius r sweeping the given degrees
+  // within MINI_CURVE_TOLERANCE, from 1 - cos(step / 2) ~= step^2 / 8
+  static inline int _segments(float r, float sweep) {
+    float step = sqrtf(8.0f * MINI_CURVE_TOLERANCE / fmaxf(fabsf(r), MINI_CURVE_TOLERANCE));
+    int segments = (int)ceilf(fabsf(sweep) * (float)(DEG2RAD) / step);
+    
+    if (segments < 3 && fabsf(sweep) >= 360) { return 3; }
+    if (segments < 1) { return 1; }
+    return segments > MINI_SEGMENTS_MAX ? MINI_SEGMENTS_MAX : segments;
+  }
+  
+  // --- TRIANGULATION --- //
+  // Ear clipping, so concave polygons fill correctly. Results are cached by
+  // a hash of the point data and replayed while the same points keep being
+  // drawn; the points are stored too, so a hash collision is just a miss.
+  // Threads recording a command list triangulate without the cache, into
+  // their own scratch, since the frame arena belongs to the main thread.
+  typedef struct {
+    unsigned long long hash;
+    int count;
+    int triangles;
+    unsigned int used;
+    float *points;
+    int *indices;
+  } PolygonEntry;
+  
+  typedef struct {
+    PolygonEntry entries[MINI_POLYGON_CACHE][MINI_POLYGON_WAYS];
+    unsigned int tick;
+    PolygonCacheStats stats;
+  } PolygonCache;
+  
+  PolygonCache polygon_cache;
+  
+  MINI_THREAD_LOCAL int *polygon_scratch;
+  MINI_THREAD_LOCAL int polygon_scratch_capacity;
+  
+  PolygonCacheStats polygonCacheStats() { return polygon_cache.stats; }
+  
+  static inline float _cross(const float *points, int a, int b, int c) {
+    return (points[b*2] - points[a*2]) * (points[c*2+1] - points[a*2+1])
+         - (points[b*2+1] - points[a*2+1]) * (points[c*2] - points[a*2]);
+  }
+  
+  static int _triangulate(const float *points, int n, int *indices, int *prev, int *next) {
+    float area = 0.0f;
+    for (int i = 0; i < n; ++i) {
+      int j = (i + 1) % n;
+      area += points[i*2] * points[j*2+1] - points[j*2] * points[i*2+1];
+      prev[i] = (i + n - 1) % n;
+      next[i] = j;
+    }
+    float sign = area < 0.0f ? -1.0f : 1.0f;
+    
+    int triangles = 0;
+    int remaining = n;
+    int misses = 0;
+    int i = 0;
+    
+    while (remaining > 3) {
+      int a = prev[i];
+      int c = next[i];
+      float cross = sign * _cross(points, a, i, c);
+      
+      // Collinear vertices are always clipped, they cover nothing
+      int ear = cross >= 0.0f;
+      if (ear && cross > 0.0f) {
+        for (int p = next[c]; p != a; p = next[p]) {
+          if (sign * _cross(points, a, i, p) >= 0.0f && sign * _cross(points, i, c, p) >= 0.0f && sign * _cross(points, c, a, p) >= 0.0f) {
+            int same = (points[p*2] == points[a*2] && points[p*2+1] == points[a*2+1])
+                    || (points[p*2] == points[c*2] && points[p*2+1] == points[c*2+1]);
+            if (!same) { ear = 0; break; }
+          }
+        }
+      }
+      
+      // A full pass without an ear means self-intersecting input; clip anyway
+      if (ear || misses >= remaining) {
+        if (cross != 0.0f) {
+          indices[triangles*3] = a;
+          indices[triangles*3+1] = i;
+          indices[triangles*3+2] = c;
+          triangles++;
+        }
+        next[a] = c;
+        prev[c] = a;
+        remaining--;
+        misses = 0;
+        i = a;
+      } else {
+        misses++;
+        i = c;
+      }
+    }
+    
+    if (_cross(points, prev[i], i, next[i]) != 0.0f) {
+      indices[triangles*3] = prev[i];
+      indices[triangles*3+1] = i;
+      indices[triangles*3+2] = next[i];
+      triangles++;
+    }
+    
+    return triangles;
+  }
+  
+  static int *_polygonScratch(int n) {
+    if (polygon_scratch_capacity < n * 5) {
+      free(polygon_scratch);
+      polygon_scratch_capacity = n * 5;
+      polygon_scratch = malloc(polygon_scratch_capacity * sizeof(int));
+      if (!polygon_scratch) { exit(-1); }
+    }
+    return polygon_scratch;
+  }
+  
+  // Triangle indices for n points, valid until the next call
+  static const int *_polygonTriangles(const float *points, int n, int *triangles) {
+    if (recording) {
+      int *scratch = _polygonScratch(n);
+      *triangles = _triangulate(points, n, scratch, scratch + n * 3, scratch + n * 4);
+      return scratch;
+    }
+    
+    // FNV-1a over the raw point words, copied out rather than read through
+    // a pointer of another type
+    unsigned long long hash = 14695981039346656037ull;
+    for (int i = 0; i < n * 2; ++i) {
+      unsigned int word;
+      memcpy(&word, &points[i], sizeof(word));
+      hash = (hash ^ word) * 1099511628211ull;
+    }
+    
+    // The low bits of a float's words are often zero, and FNV only carries
+    // bits upwards, so the set comes from the folded hash
+    PolygonEntry *set = polygon_cache.entries[(hash ^ (hash >> 32)) % MINI_POLYGON_CACHE];
+    PolygonEntry *victim = &set[0];
+    polygon_cache.tick++;
+    
+    for (int w = 0; w < MINI_POLYGON_WAYS; ++w) {
+      PolygonEntry *entry = &set[w];
+      if (entry->points && entry->hash == hash && entry->count == n && memcmp(entry->points, points, n * 2 * sizeof(float)) == 0) {
+        entry->used = polygon_cache.tick;
+        polygon_cache.stats.hits++;
+        *triangles = entry->triangles;
+        return entry->indices;
+      }
+      
+      if (!entry->points) {
+        victim = entry;
+      } else if (victim->points && entry->used < victim->used) {
+        victim = entry;
+      }
+    }
+    
+    polygon_cache.stats.misses++;
+    if (victim->points) {
+      polygon_cache.stats.evictions++;
+      free(victim->points);
+    } else {
+      polygon_cache.stats.entries++;
+    }
+    
+    // Points and indices share one allocation
+    victim->points = malloc(n * 2 * sizeof(float) + n * 3 * sizeof(int));
+    if (!victim->points) { exit(-1); }
+    victim->indices = (int *)(victim->points + n * 2);
+    memcpy(victim->points, points, n * 2 * sizeof(float));
+    
+    int *scratch = frameAlloc(n * 2 * sizeof(int));
+    victim->hash = hash;
+    victim->count = n;
+    victim->used = polygon_cache.tick;
+    victim->triangles = _triangulate(points, n, victim->indices, scratch, scratch + n);
+    
+    *triangles = victim->triangles;
+    return victim->indices;
+  }
+  
+  // Frees every cached polygon and the calling thread's scratch
+  void _polygonCacheFree() {
+    for (int i = 0; i < MINI_POLYGON_CACHE; ++i) {
+      for (int w = 0; w < MINI_POLYGON_WAYS; ++w) { free(polygon_cache.entries[i][w].points); }
+    }
+    memset(&polygon_cache, 0, sizeof(polygon_cache));
+    
+    free(polygon_scratch);
+    polygon_scratch = NULL;
+    polygon_scratch_capacity = 0;
+  }
+  
+  // --- WINDOW --- //
+  
+  #ifdef MINI_BACKEND_SOFTWARE
+    // Headless windows have no title to show
+    void windowInit(int w, int h, const char *title) {
+      (void)title;
+      framebuffer.pixels = calloc(w * h, sizeof(Color));
+      if (!framebuffer.pixels) {
+        exit(-1);
+      }
+      
+      framebuffer.w = w;
+      framebuffer.h = h;
+      _clipSet(NULL);
+      
+      mini_window = (Window){0};
+      mini_window.w = w;
+      mini_window.h = h;
+      mini_window.prev = _now();
+      
+      _trigInit();
+      
+      #ifdef MINI_FONTS
+        _fontsInit();
+      #endif
+      
+      _viewUpdate();
+      
+      #ifdef MINI_DAMAGE
+        windowInvalidateAll();
+      #endif
     }
-
-    glfw_window = glfwCreateWindow(w, h, "Hello World", NULL, NULL);
-    if (!glfw_window) {
-        glfwTerminate();
-        exit(-1);
+    
+    // Headless windows never close on their own, the caller owns the loop
+    int windowShouldClose() { return 0; }
+    
+    void windowUpdate() {
+      TRACE_FRAME();
+      #ifdef MINI_DAMAGE
+        if (windowDamaged()) {
+          batchFlush();
+          #ifdef MINI_CAPTURE
+            _captureFrame();
+          #endif
+          _damageEnd();
+        } else {
+          _damageSkip();
+        }
+        batch.count = 0;
+      #else
+        batchFlush();
+        #ifdef MINI_CAPTURE
+          _captureFrame();
+        #endif
+      #endif
+      batch.last = batch.frame;
+      batch.frame = (BatchStats){0};
+      PICK_FRAME();
+      QUEUE_FRAME();
+      _arenaReset();
+      
+      PROFILE_BEGIN(PROFILE_SLEEP);
+      _pace();
+      PROFILE_END(PROFILE_SLEEP);
+      
+      _inputUpdate();
+      
+      double current = _now();
+      mini_window.dt = current - mini_window.prev;
+      mini_window.prev = current;
+      
+      PROFILE_FRAME();
+    }
+    
+    void windowClose() {
+      free(framebuffer.pixels);
+      framebuffer = (Surface){0};
+      
+      for (int i = 0; i < texture_count; ++i) {
+        free(textures[i].pixels);
+        textures[i] = (Surface){0};
+      }
+      texture_count = 0;
+      _arenaFree();
+      _polygonCacheFree();
+      
+      #ifdef MINI_CAPTURE
+        captureStop();
+      #endif
+      #ifdef MINI_TRACE
+        traceStop();
+      #endif
     }
     
-    Window window = {0};
-    window.w = w;
-    window.h = h;
-    window.dt = 0.0;
-    window.prev = 0.0;
+    void _clear(Color color) {
+      for (int y = clip.y0; y < clip.y1; ++y) {
+        _spanStore(framebuffer.pixels + y * framebuffer.w + clip.x0, clip.x1 - clip.x0, color);
+      }
+    }
     
-    glfwSetWindowUserPointer(glfw_window, &window);
-    glfwSetMouseButtonCallback(glfw_window, _mouseButton);
-    glfwMakeContextCurrent(glfw_window);
-    glfwSwapInterval(1);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, w, h, 0, 0, 1.0f);
-    glClearColor(0.3, 0.3, 0.9 ,0);
-  }
-  
-  int windowShouldClose() { return glfwWindowShouldClose(glfw_window); }
+    void windowClear(Color color) {
+      TRACE_DATA(TRACE_OP_CLEAR, 0, &color, sizeof(Color), NULL, 0, NULL, 0);
+      batchFlush();
+      if (layer_target) {
+        _clipSet(NULL);
+        _clear(color);
+        return;
+      }
+      
+      #ifdef MINI_DAMAGE
+        _damageSeal();
+        for (int i = 0; i < damage.region_count; ++i) {
+          if (_clipBegin(&damage.region[i])) { _clear(color); }
+        }
+      #else
+        if (_clipBegin(NULL)) { _clear(color); }
+      #endif
+      _clipSet(NULL);
+    }
+    
+    Color *windowPixels() {
+      batchFlush();
+      return framebuffer.pixels;
+    }
+  #else
+    void windowInit(int w, int h, const char *title) {
+      if (!glfwInit()) {
+        exit(-1);
+      }
   
-  void windowUpdate() { 
-    glfwSwapBuffers(glfw_window);
+      glfw_window = glfwCreateWindow(w, h, "Hello World", NULL, NULL);
+      if (!glfw_window) {
+          glfwTerminate();
+          exit(-1);
+      }
+      
+      mini_window = (Window){0};
+      mini_window.w = w;
+      mini_window.h = h;
+      mini_window.dt = 0.0;
+      mini_window.prev = 0.0;
+      
+      glfwSetWindowUserPointer(glfw_window, &mini_window);
+      glfwSetMouseButtonCallback(glfw_window, _mouseButton);
+      glfwSetKeyCallback(glfw_window, _keyCallback);
+      glfwSetCharCallback(glfw_window, _charCallback);
+      glfwSetCursorPosCallback(glfw_window, _cursorCallback);
+      glfwMakeContextCurrent(glfw_window);
+      glfwSwapInterval(1);
+      mini_window.vsync = 1;
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glEnableClientState(GL_COLOR_ARRAY);
+      glAlphaFunc(GL_GREATER, 0.0f);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glMatrixMode(GL_PROJECTION);
+      glLoadIdentity();
+      glOrtho(0, w, h, 0, 0, 1.0f);
+      glClearColor(0.3, 0.3, 0.9 ,0);
+      
+      // Alpha accumulates as coverage, which keeps layer pixels premultiplied
+      _glLoad();
+      if (_glBlendFuncSeparate) {
+        _glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      }
+      _trigInit();
+      
+      #ifdef MINI_FONTS
+        _fontsInit();
+      #endif
+      
+      _viewUpdate();
+      
+      #ifdef MINI_DAMAGE
+        windowInvalidateAll();
+      #endif
+    }
     
-    Window *win = glfwGetWindowUserPointer(glfw_window);
-    Mouse prev = win->mouse;
+    int windowShouldClose() { return glfwWindowShouldClose(glfw_window); }
     
-    #if defined(MINI_GUI_MODE)
-      glfwWaitEvents();
-    #else
-      glfwPollEvents();
-    #endif
+    void windowUpdate() { 
+      TRACE_FRAME();
+      #ifdef MINI_DAMAGE
+        int present = windowDamaged();
+        if (present) { batchFlush(); }
+        batch.count = 0;
+      #else
+        int present = 1;
+        batchFlush();
+      #endif
+      batch.last = batch.frame;
+      batch.frame = (BatchStats){0};
+      PICK_FRAME();
+      QUEUE_FRAME();
+      _arenaReset();
+      
+      if (present) {
+        #ifdef MINI_CAPTURE
+          _captureFrame();
+        #endif
+        
+        PROFILE_BEGIN(PROFILE_SWAP);
+        glfwSwapBuffers(glfw_window);
+        if (mini_window.lowlatency) { glFinish(); }
+        PROFILE_END(PROFILE_SWAP);
+        
+        #ifdef MINI_DAMAGE
+          _damageEnd();
+        #endif
+      }
+      #ifdef MINI_DAMAGE
+        if (!present) { _damageSkip(); }
+      #endif
+      
+      PROFILE_BEGIN(PROFILE_SLEEP);
+      _pace();
+      PROFILE_END(PROFILE_SLEEP);
+      
+      Window *win = &mini_window;
+      
+      PROFILE_BEGIN(PROFILE_EVENTS);
+      #if defined(MINI_GUI_MODE)
+        if (win->timeout > 0.0) {
+          glfwWaitEventsTimeout(win->timeout);
+        } else {
+          glfwWaitEvents();
+        }
+      #else
+        glfwPollEvents();
+      #endif
+      _inputUpdate();
+      PROFILE_END(PROFILE_EVENTS);
+      
+      double current = _now();
+      win->dt = current - win->prev;
+      win->prev = current;
+      
+      PROFILE_FRAME();
+    }
     
-    if (prev.state == CLICK && win->mouse.state == CLICK) {
-      win->mouse.state == PRESS;
-    } else if (prev.state == RELEASE && win->mouse.state == RELEASE) {
-      win->mouse.state == NONE;
+    void windowClose() {
+      #ifdef MINI_CAPTURE
+        captureStop();
+      #endif
+      #ifdef MINI_TRACE
+        traceStop();
+      #endif
+      if (upload_buffers[0]) {
+        _glDeleteBuffers(MINI_UPLOAD_BUFFERS, upload_buffers);
+        memset(upload_buffers, 0, sizeof(upload_buffers));
+      }
+      _arenaFree();
+      _polygonCacheFree();
+      glfwTerminate();
     }
     
-    double current = glfwGetTime();
-    win->dt = current - win->prev;
-    win->prev = current;
-  }
-  
-  void windowClose() { glfwTerminate(); }
-  
-  void windowClear(Color color) {
-    float r = (float)color.r / 0xFF;
-    float g = (float)color.g / 0xFF;
-    float b = (float)color.b / 0xFF;
-    float a = (float)color.a / 0xFF;
-    glClearColor(r, g, b, a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
-  }
+    void windowClear(Color color) {
+      TRACE_DATA(TRACE_OP_CLEAR, 0, &color, sizeof(Color), NULL, 0, NULL, 0);
+      float r = (float)color.r / 0xFF;
+      float g = (float)color.g / 0xFF;
+      float b = (float)color.b / 0xFF;
+      float a = (float)color.a / 0xFF;
+      batchFlush();
+      glClearColor(r, g, b, a);
+      if (layer_target) {
+        _clipSet(NULL);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        return;
+      }
+      
+      #ifdef MINI_DAMAGE
+        _damageSeal();
+        for (int i = 0; i < damage.region_count; ++i) {
+          if (_clipBegin(&damage.region[i])) { glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); }
+        }
+      #else
+        if (_clipBegin(NULL)) { glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); }
+      #endif
+      _clipSet(NULL);
+    }
+  #endif
   
   Color colorHex(unsigned int c) {
     if (c <= 0xFF) { return (Color){c, c, c, 0xFF}; }
@@ -201,7 +3106,7 @@
     unsigned int g = (c >> 16) & 0xFF;
     unsigned int b = (c >>  8) & 0xFF;
     unsigned int a = c & 0xFF;
-
+    
     return (Color){r, g, b, a};
   }
   
@@ -215,60 +3120,107 @@
   
   // --- TIME --- //
   double delta() {
-    Window *win = glfwGetWindowUserPointer(glfw_window);
-    return win->dt;
+    return mini_window.dt;
+  }
+  
+  // --- LOOP --- //
+  // 0 disables pacing and leaves the frame rate to vsync
+  void windowSetTargetFPS(int fps) {
+    mini_window.fps = fps;
+  }
+  
+  void windowSetVSync(int enabled) {
+    mini_window.vsync = enabled;
+    #ifndef MINI_BACKEND_SOFTWARE
+      glfwSwapInterval(enabled ? 1 : 0);
+    #endif
+  }
+  
+  // Waits for the GPU after every swap so the driver cannot queue frames
+  // ahead, and events are then polled right before the next frame is built
+  void windowSetLowLatency(int enabled) {
+    mini_window.lowlatency = enabled;
+  }
+  
+  // In MINI_GUI_MODE, wakes up after this long even without events so
+  // animations can run; 0 waits for events indefinitely
+  void windowSetWakeTimeout(double seconds) {
+    mini_window.timeout = seconds;
+  }
+  
+  // Runs update at a fixed step from an accumulator fed by delta(), then
+  // render with how far the accumulator is into the next step, for
+  // interpolating between the last two simulation states. Input edges
+  // (keyPressed, mouseClicked) last one frame, so frames that run no step
+  // should read them in render.
+  void loopRun(double step, void (*update)(double step), void (*render)(double alpha)) {
+    mini_window.accumulator = 0.0;
+    
+    while (!windowShouldClose()) {
+      mini_window.accumulator += delta();
+      if (mini_window.accumulator > step * MINI_LOOP_MAX_STEPS) {
+        mini_window.accumulator = step * MINI_LOOP_MAX_STEPS;
+      }
+      
+      while (mini_window.accumulator >= step) {
+        update(step);
+        mini_window.accumulator -= step;
+      }
+      
+      render(mini_window.accumulator / step);
+      windowUpdate();
+    }
   }
   
   // --- INPUT --- //
   Vec2 mousePosition() {
-    double x;
-    double y;
-    glfwGetCursorPos(glfw_window, &x, &y);
-    return (Vec2){(int)x, (int)y};
+    return (Vec2){mini_window.mouse.x, mini_window.mouse.y};
   }
   
   int mouseClicked(int button) {
-    Window *win = glfwGetWindowUserPointer(glfw_window);
-    return win->mouse.button == button && win->mouse.state == CLICK;
+    return (mini_window.mouse.pressed & button) != 0;
   }
   
   int mousePressed(int button) {
-    Window *win = glfwGetWindowUserPointer(glfw_window);
-    return win->mouse.button == button && win->mouse.state == PRESS;
+    return (mini_window.mouse.held & button) != 0;
   }
   
   int mouseReleased(int button) {
-    Window *win = glfwGetWindowUserPointer(glfw_window);
-    return win->mouse.button == button && win->mouse.state == RELEASE;
+    return (mini_window.mouse.released & button) != 0;
   }
   
   int keyPressed(int key) {
-    return glfwGetKey(glfw_window, key) == GLFW_PRESS;
+    return key >= 0 && key < MINI_KEYS && mini_window.keyboard.pressed[key];
+  }
+  
+  int keyHeld(int key) {
+    return key >= 0 && key < MINI_KEYS && mini_window.keyboard.held[key];
   }
   
-  // Not working as intended
-  // TODO: Add keyHeld();
   int keyReleased(int key) {
-    return glfwGetKey(glfw_window, key) == GLFW_RELEASE;
+    return key >= 0 && key < MINI_KEYS && mini_window.keyboard.released[key];
   }
   
   // --- DRAWING --- //
   void drawLine(float x0, float y0, float x1, float y1, Color color) {
-    glBegin(GL_LINES);
-      glColor4ub(color.r, color.g, color.b, color.a); 
-      glVertex2f(x0, y0);
-      glVertex2f(x1, y1);
-    glEnd();
+    TRACE_SHAPE(TRACE_OP_LINE, 0, color, x0, y0, x1, y1);
+    if (!_visible(fminf(x0, x1) - 1, fminf(y0, y1) - 1, fmaxf(x0, x1) + 1, fmaxf(y0, y1) + 1)) { return; }
+    _batchLine(x0, y0, x1, y1, color);
   }
   
   // Triangles
   void _drawTriangle(float x0, float y0, float x1, float y1, float x2, float y2, Color color, int mode) {
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a); 
-      glVertex2f(x0, y0);
-      glVertex2f(x1, y1);
-      glVertex2f(x2, y2);
-    glEnd();
+    TRACE_SHAPE(TRACE_OP_TRIANGLE, mode, color, x0, y0, x1, y1, x2, y2);
+    if (!_visible(fminf(x0, fminf(x1, x2)) - 1, fminf(y0, fminf(y1, y2)) - 1, fmaxf(x0, fmaxf(x1, x2)) + 1, fmaxf(y0, fmaxf(y1, y2)) + 1)) { return; }
+    PICK_POLYGON(((float[]){x0, y0, x1, y1, x2, y2}), 6);
+    
+    if (mode == GL_LINE_LOOP) {
+      _batchLine(x0, y0, x1, y1, color);
+      _batchLine(x1, y1, x2, y2, color);
+      _batchLine(x2, y2, x0, y0, color);
+    } else {
+      _batchTriangle(x0, y0, x1, y1, x2, y2, color);
+    }
   }
   
   inline void drawTriangle(float x0, float y0, float x1, float y1, float x2, float y2, Color color) {
@@ -281,13 +3233,19 @@
   
   // Rectangles
   void _drawRectangle(float x, float y, float w, float h, Color color, int mode) {
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a); 
-      glVertex2f(x, y);
-      glVertex2f(x + w, y);
-      glVertex2f(x + w, y + h);
-      glVertex2f(x, y + h);
-    glEnd();
+    TRACE_SHAPE(TRACE_OP_RECTANGLE, mode, color, x, y, w, h);
+    if (!_visible(fminf(x, x + w) - 1, fminf(y, y + h) - 1, fmaxf(x, x + w) + 1, fmaxf(y, y + h) + 1)) { return; }
+    PICK_RECT(fminf(x, x + w), fminf(y, y + h), fmaxf(x, x + w), fmaxf(y, y + h));
+    
+    if (mode == GL_LINE_LOOP) {
+      _batchLine(x, y, x + w, y, color);
+      _batchLine(x + w, y, x + w, y + h, color);
+      _batchLine(x + w, y + h, x, y + h, color);
+      _batchLine(x, y + h, x, y, color);
+    } else {
+      _batchTriangle(x, y, x + w, y, x + w, y + h, color);
+      _batchTriangle(x, y, x + w, y + h, x, y + h, color);
+    }
   }
   
   inline void drawRectangle(float x, float y, float w, float h, Color color) {
@@ -300,17 +3258,36 @@
   
   // Polygons
   void _drawPolygon(float *points, int count, Color color, int mode) {
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a); 
-      for (int i = 0; i < count; i += 2) {
-        glVertex2f(points[i], points[i+1]);
+    TRACE_SHAPE_DATA(TRACE_OP_POLYGON, mode, color, points, count * sizeof(float), count);
+    int n = count / 2;
+    if (n < 2) { return; }
+    
+    float x0 = points[0], y0 = points[1], x1 = points[0], y1 = points[1];
+    for (int i = 1; i < n; ++i) {
+      x0 = fminf(x0, points[i*2]);
+      y0 = fminf(y0, points[i*2+1]);
+      x1 = fmaxf(x1, points[i*2]);
+      y1 = fmaxf(y1, points[i*2+1]);
+    }
+    if (!_visible(x0 - 1, y0 - 1, x1 + 1, y1 + 1)) { return; }
+    PICK_POLYGON(points, count);
+    
+    if (mode == GL_LINE_LOOP) {
+      for (int i = 0; i < n; ++i) {
+        int j = (i + 1) % n;
+        _batchLine(points[i*2], points[i*2+1], points[j*2], points[j*2+1], color);
       }
+    } else if (n >= 3) {
+      int triangles;
+      const int *indices = _polygonTriangles(points, n, &triangles);
       
-      if (mode == GL_TRIANGLE_STRIP) {
-        glVertex2f(points[0], points[1]);
+      for (int t = 0; t < triangles; ++t) {
+        int i = indices[t*3];
+        int j = indices[t*3+1];
+        int k = indices[t*3+2];
+        _batchTriangle(points[i*2], points[i*2+1], points[j*2], points[j*2+1], points[k*2], points[k*2+1], color);
       }
-      
-    glEnd();
+    }
   }
   
   inline void drawPolygon(float *points, int count, Color color) {
@@ -321,20 +3298,51 @@
     _drawPolygon(points, count, color, GL_TRIANGLE_STRIP);
   }
   
+  // Outlines as signed-distance quads are outline_width wide
+  MINI_THREAD_LOCAL float outline_width = 1.0f;
+  
+  void outlineWidth(float width) {
+    outline_width = width > 0.0f ? width : 1.0f;
+    TRACE_ARGS(TRACE_OP_OUTLINE_WIDTH, 0, outline_width);
+  }
+  
+  // Stroke for the SDF path and extra culling extent, 0 for filled shapes
+  static inline float _stroke(int mode) {
+    return mode == GL_LINE_LOOP ? outline_width : 0.0f;
+  }
+  
   // Circles
   void _drawCircle(float x, float y, float r, Color color, int mode) {
-    int segments = 36;
+    TRACE_SHAPE(TRACE_OP_CIRCLE, mode, color, x, y, r);
+    float extent = fabsf(r) + _stroke(mode) * 0.5f + 1;
+    if (!_visible(x - extent, y - extent, x + extent, y + extent)) { return; }
+    PICK_SECTOR(x, y, 0.0f, fabsf(r), 0.0f, 360.0f);
     
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a);
-      if (mode == GL_TRIANGLE_STRIP) {
-        glVertex2f(x, y);
-      }
+    #ifdef MINI_SDF
+      if (_batchSdf(x, y, -1.0f, fabsf(r), 0, 360, _stroke(mode), color)) { return; }
+    #endif
+    
+    int segments = _segments(r, 360);
+    float step = 1.0f / segments;
+    
+    float px = x + r;
+    float py = y;
+    
+    for (int i = 1; i <= segments; ++i) {
+      float s, c;
+      _unit(i * step, &s, &c);
+      float cx = x + r * c;
+      float cy = y + r * s;
       
-      for (int i = 0; i <= segments; ++i) {
-        glVertex2f(x + (r * cos(i * (M_PI * 2) / segments)), y + (r * sin(i * (M_PI * 2) / segments)));
+      if (mode == GL_LINE_LOOP) {
+        _batchLine(px, py, cx, cy, color);
+      } else {
+        _batchTriangle(x, y, px, py, cx, cy, color);
       }
-    glEnd();
+      
+      px = cx;
+      py = cy;
+    }
   }
   
   inline void drawCircle(float x, float y, float r, Color color) {
@@ -347,34 +3355,49 @@
   
   // Slices
   void _drawSlice(float x, float y, float r, float start, float end, Color color, int mode) {
-    int segments = 36;
+    TRACE_SHAPE(TRACE_OP_SLICE, mode, color, x, y, r, start, end);
+    float extent = fabsf(r) + _stroke(mode) * 0.5f + 1;
+    if (!_visible(x - extent, y - extent, x + extent, y + extent)) { return; }
     
     end = end - start > 360 ? start + 360 : end;
-    float stride = (end - start) / (float)segments;
-    float angle = start;
+    PICK_SECTOR(x, y, 0.0f, fabsf(r), start, end);
+    
+    #ifdef MINI_SDF
+      if (_batchSdf(x, y, -1.0f, fabsf(r), start, end, _stroke(mode), color)) { return; }
+    #endif
+    
+    int segments = _segments(r, end - start);
+    float stride = (end - start) / 360.0f / segments;
+    float angle = start / 360.0f;
+    
+    float s, c;
+    _unit(angle, &s, &c);
+    float px = x + s * r;
+    float py = y + c * r;
+    
+    if (mode == GL_LINE_LOOP && end - start < 360) {
+      _batchLine(x, y, px, py, color);
+    }
     
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a);
+    for (int i = 0; i < segments; ++i) {
+      angle += stride;
+      _unit(angle, &s, &c);
+      float cx = x + s * r;
+      float cy = y + c * r;
       
-      if (mode == GL_TRIANGLE_FAN) {
-        for (int i = 0; i < segments; ++i) {
-          float a = DEG2RAD * angle;
-          glVertex2f(x, y);
-          glVertex2f(x + sin(a) * r, y + cos(a) * r);
-          glVertex2f(x + sin(DEG2RAD * angle) * r, y + cos(DEG2RAD * angle) * r);
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r, y + cos(DEG2RAD * (angle + stride)) * r);
-          angle += stride;
-        }
+      if (mode == GL_LINE_LOOP) {
+        _batchLine(px, py, cx, cy, color);
       } else {
-        if (end < 360) { glVertex2f(x, y); }
-        
-        for (int i = 0; i < segments; ++i) {
-          glVertex2f(x + sin(DEG2RAD * angle) * r, y + cos(DEG2RAD * angle) * r);
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r, y + cos(DEG2RAD * (angle + stride)) * r);
-          angle += stride;
-        }
+        _batchTriangle(x, y, px, py, cx, cy, color);
       }
-    glEnd();
+      
+      px = cx;
+      py = cy;
+    }
+    
+    if (mode == GL_LINE_LOOP && end - start < 360) {
+      _batchLine(px, py, x, y, color);
+    }
   }
   
   inline void drawSlice(float x, float y, float r, float start, float end, Color color) {
@@ -387,54 +3410,51 @@
   
   // Arcs
   void _drawArc(float x, float y, float r1, float thickness, float start, float end, Color color, int mode) {
-    int segments = 36;
-
+    TRACE_SHAPE(TRACE_OP_ARC, mode, color, x, y, r1, thickness, start, end);
     float r2 = r1 + thickness;
     
+    float extent = fmaxf(fabsf(r1), fabsf(r2)) + _stroke(mode) * 0.5f + 1;
+    if (!_visible(x - extent, y - extent, x + extent, y + extent)) { return; }
+    
     end = end - start > 360 ? start + 360 : end;
+    PICK_SECTOR(x, y, fminf(fabsf(r1), fabsf(r2)), fmaxf(fabsf(r1), fabsf(r2)), start, end);
+    
+    #ifdef MINI_SDF
+      if (_batchSdf(x, y, fminf(r1, r2), fmaxf(r1, r2), start, end, _stroke(mode), color)) { return; }
+    #endif
+    
+    int segments = _segments(fmaxf(r1, r2), end - start);
+    float stride = (end - start) / 360.0f / segments;
+    float angle = start / 360.0f;
     
-    float stride = (end - start) / (float)segments;
-    float angle = start;
+    float ps, pc;
+    _unit(angle, &ps, &pc);
     
-    glBegin(mode);
-      glColor4ub(color.r, color.g, color.b, color.a);
+    // Caps join the inner and outer edge unless the arc is a full ring
+    if (mode == GL_LINE_LOOP && (int)start != ((int)end % 360)) {
+      _batchLine(x + ps * r1, y + pc * r1, x + ps * r2, y + pc * r2, color);
+    }
+    
+    for (int i = 0; i < segments; ++i) {
+      angle += stride;
+      float cs, cc;
+      _unit(angle, &cs, &cc);
       
-      if (mode == GL_TRIANGLE_STRIP) {
-        for (int i = 0; i < segments; ++i) {
-          float a = DEG2RAD*angle;
-
-          glVertex2f(x + sin(a) * r1, y + cos(a) * r1);
-          glVertex2f(x + sin(a) * r2, y + cos(a) * r2);
-          
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r1, y + cos(DEG2RAD * (angle + stride)) * r1);
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r1, y + cos(DEG2RAD * (angle + stride)) * r1);
-          
-          glVertex2f(x + sin(a) * r2, y + cos(a) * r2);
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r2, y + cos(DEG2RAD * (angle + stride)) * r2);
-          
-          angle += stride;
-        }
+      if (mode == GL_LINE_LOOP) {
+        _batchLine(x + ps * r2, y + pc * r2, x + cs * r2, y + cc * r2, color);
+        _batchLine(x + ps * r1, y + pc * r1, x + cs * r1, y + cc * r1, color);
       } else {
-        for (int i = 0; i < segments; ++i) {
-          float a = DEG2RAD*angle;
-          glVertex2f(x + sin(a) * r2, y + cos(a) * r2);
-          glVertex2f(x + sin(DEG2RAD * (angle + stride)) * r2, y + cos(DEG2RAD * (angle + stride)) * r2);
-          angle += stride;
-        }
-        
-        if ((int)start == ((int)end % 360)) {
-          glEnd();
-          glBegin(mode);
-        }
-        
-        for (int i = 0; i < segments; ++i) {
-          float a = DEG2RAD*angle;
-          glVertex2f(x + sin(a) * r1, y + cos(a) * r1);
-          glVertex2f(x + sin(DEG2RAD * (angle - stride)) * r1, y + cos(DEG2RAD * (angle - stride)) * r1);
-          angle -= stride;
-        }
+        _batchTriangle(x + ps * r1, y + pc * r1, x + ps * r2, y + pc * r2, x + cs * r1, y + cc * r1, color);
+        _batchTriangle(x + cs * r1, y + cc * r1, x + ps * r2, y + pc * r2, x + cs * r2, y + cc * r2, color);
       }
-    glEnd();
+      
+      ps = cs;
+      pc = cc;
+    }
+    
+    if (mode == GL_LINE_LOOP && (int)start != ((int)end % 360)) {
+      _batchLine(x + ps * r1, y + pc * r1, x + ps * r2, y + pc * r2, color);
+    }
   }
   
   inline void drawArc(float x, float y, float r1, float thickness, float start, float end, Color color) {
@@ -444,5 +3464,553 @@
   inline void drawArcFilled(float x, float y, float r1, float thickness, float start, float end, Color color) {
     _drawArc(x, y, r1, thickness, start, end, color, GL_TRIANGLE_STRIP);
   }
+  
+  // --- INSTANCES --- //
+  // Every instance of a shape shares one unit mesh, a quad or a circle fan,
+  // placed by its own position, size and color attributes in a single
+  // instanced draw. Without instancing, or while recording, the instances
+  // are expanded into the batch instead.
+  typedef struct {
+    float mesh[(MINI_SEGMENTS_MAX + 2) * 2];
+    int vertices;
+    int mode;
+    const float *shapes;
+    int components;
+    const Color *colors;
+    int count;
+    #ifndef MINI_BACKEND_SOFTWARE
+      GLuint program;
+      GLint circle;
+      int failed;
+    #endif
+  } Instances;
+  
+  Instances instances;
+  
+  // Unit circle around the origin, one segment longer than needed so the
+  // fan closes
+  static void _unitCircle(float *mesh, int segments) {
+    for (int i = 0; i <= segments; ++i) {
+      _unit((float)i / segments, &mesh[i*2+1], &mesh[i*2]);
+    }
+  }
+  
+  #ifndef MINI_BACKEND_SOFTWARE
+    static int _instancesReady() {
+      if (instances.program) { return 1; }
+      if (instances.failed || !_glDrawArraysInstanced || !_glVertexAttribDivisor) { return 0; }
+      
+      const char *vertex =
+        "#version 120\n"
+        "attribute vec2 corner;\n"
+        "attribute vec4 shape;\n"
+        "attribute vec4 color;\n"
+        "uniform float circle;\n"
+        "varying vec4 tint;\n"
+        "void main() {\n"
+        "  tint = color;\n"
+        "  vec2 size = mix(shape.zw, shape.zz, circle);\n"
+        "  gl_Position = gl_ModelViewProjectionMatrix * vec4(shape.xy + corner * size, 0.0, 1.0);\n"
+        "}\n";
+      const char *fragment =
+        "#version 120\n"
+        "varying vec4 tint;\n"
+        "void main() { gl_FragColor = tint; }\n";
+      const char *attribs[] = {"corner", "shape", "color"};
+      
+      instances.program = _glProgram(vertex, fragment, attribs, 3);
+      if (!instances.program) {
+        instances.failed = 1;
+        return 0;
+      }
+      instances.circle = _glGetUniformLocation(instances.program, "circle");
+      return 1;
+    }
+    
+    static void _instancesDraw() {
+      _glUseProgram(instances.program);
+      _glUniform1f(instances.circle, instances.components == 3 ? 1.0f : 0.0f);
+      
+      glDisableClientState(GL_VERTEX_ARRAY);
+      glDisableClientState(GL_COLOR_ARRAY);
+      for (int i = 0; i < 3; ++i) { _glEnableVertexAttribArray(i); }
+      
+      _glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, instances.mesh);
+      _glVertexAttribPointer(1, instances.components, GL_FLOAT, GL_FALSE, 0, instances.shapes);
+      _glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, instances.colors);
+      _glVertexAttribDivisor(1, 1);
+      _glVertexAttribDivisor(2, 1);
+      _glDrawArraysInstanced(instances.mode, 0, instances.vertices, instances.count);
+      _glVertexAttribDivisor(1, 0);
+      _glVertexAttribDivisor(2, 0);
+      
+      for (int i = 0; i < 3; ++i) { _glDisableVertexAttribArray(i); }
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glEnableClientState(GL_COLOR_ARRAY);
+      _glUseProgram(0);
+    }
+  #endif
+  
+  // Issues the instanced draw if possible, after anything already batched
+  static int _instancesSubmit(int mode, const float *mesh, int vertices, const float *shapes, int components, const Color *colors, int count) {
+    #ifdef MINI_BACKEND_SOFTWARE
+      (void)mode, (void)mesh, (void)vertices, (void)shapes, (void)components, (void)colors, (void)count;
+      return 0;
+    #else
+      if (recording || !_instancesReady()) { return 0; }
+      
+      batchFlush();
+      memcpy(instances.mesh, mesh, vertices * 2 * sizeof(float));
+      instances.vertices = vertices;
+      instances.mode = mode;
+      instances.shapes = shapes;
+      instances.components = components;
+      instances.colors = colors;
+      instances.count = count;
+      
+      PROFILE_BEGIN(PROFILE_FLUSH);
+      _drawClipped(_instancesDraw);
+      PROFILE_END(PROFILE_FLUSH);
+      
+      batch.frame.vertices += instances.vertices * count;
+      batch.frame.flushes++;
+      batch.frame.drawn += count;
+      return 1;
+    #endif
+  }
+  
+  void drawRectanglesFilled(const float *xywh, const Color *colors, int n) {
+    if (n <= 0) { return; }
+    TRACE_DATA(TRACE_OP_RECTANGLES, 0, &n, sizeof(n), xywh, n * 4 * sizeof(float), colors, n * sizeof(Color));
+    
+    static const float quad[] = {0, 0, 1, 0, 1, 1, 0, 1};
+    if (_instancesSubmit(GL_TRIANGLE_FAN, quad, 4, xywh, 4, colors, n)) { return; }
+    
+    for (int i = 0; i < n; ++i) {
+      const float *r = &xywh[i*4];
+      if (!_visible(fminf(r[0], r[0] + r[2]), fminf(r[1], r[1] + r[3]), fmaxf(r[0], r[0] + r[2]), fmaxf(r[1], r[1] + r[3]))) { continue; }
+      _batchQuad(0, r[0], r[1], r[2], r[3], 0, 0, 0, 0, colors[i]);
+    }
+  }
+  
+  void drawCirclesFilled(const float *xyr, const Color *colors, int n) {
+    if (n <= 0) { return; }
+    TRACE_DATA(TRACE_OP_CIRCLES, 0, &n, sizeof(n), xyr, n * 3 * sizeof(float), colors, n * sizeof(Color));
+    
+    // Every instance gets the segment count of the largest one
+    float radius = 0.0f;
+    for (int i = 0; i < n; ++i) { radius = fmaxf(radius, fabsf(xyr[i*3+2])); }
+    int segments = _segments(radius, 360);
+    
+    // The fan's centre comes first, then the rim
+    float fan[(MINI_SEGMENTS_MAX + 2) * 2] = {0.0f, 0.0f};
+    float *unit = &fan[2];
+    _unitCircle(unit, segments);
+    if (_instancesSubmit(GL_TRIANGLE_FAN, fan, segments + 2, xyr, 3, colors, n)) { return; }
+    
+    for (int i = 0; i < n; ++i) {
+      float x = xyr[i*3], y = xyr[i*3+1], r = xyr[i*3+2];
+      float extent = fabsf(r) + 1;
+      if (!_visible(x - extent, y - extent, x + extent, y + extent)) { continue; }
+      
+      Vertex *v = _batchBegin(GL_TRIANGLES, 0, segments * 3);
+      for (int j = 0; j < segments; ++j) {
+        v[j*3] = (Vertex){x, y, 0.0f, 0.0f, colors[i]};
+        v[j*3+1] = (Vertex){x + unit[j*2] * r, y + unit[j*2+1] * r, 0.0f, 0.0f, colors[i]};
+        v[j*3+2] = (Vertex){x + unit[j*2+2] * r, y + unit[j*2+3] * r, 0.0f, 0.0f, colors[i]};
+      }
+    }
+  }
+  
+  // --- POLYLINES --- //
+  // Each segment is a quad trimmed to the inner corner of its joins where
+  // the segments are long enough, and each join fans from that corner over
+  // the outer edge, so nothing is covered twice. The whole line goes into
+  // the batch as one run of triangles.
+  typedef struct {
+    LineJoin join;
+    LineCap cap;
+    float decimate;
+  } LineStyle;
+  
+  // Per thread, so a recording thread never sees another one's style
+  MINI_THREAD_LOCAL LineStyle line_style = {JOIN_MITER, CAP_BUTT, 0.0f};
+  
+  void lineStyle(LineJoin join, LineCap cap, float decimate) {
+    line_style = (LineStyle){join, cap, decimate};
+    TRACE_ARGS(TRACE_OP_LINE_STYLE, 0, join, cap, decimate);
+  }
+  
+  // Next point further than sqrt(min2) from point i; the last point is kept
+  // whenever it moved at all. Returns n when there is none.
+  static int _polylineNext(const float *points, int n, int i, float min2) {
+    for (int j = i + 1; j < n; ++j) {
+      float dx = points[j*2] - points[i*2];
+      float dy = points[j*2+1] - points[i*2+1];
+      float d2 = dx * dx + dy * dy;
+      if (d2 > min2 || (j == n - 1 && d2 > 0.0f)) { return j; }
+    }
+    return n;
+  }
+  
+  // Fans from (cx, cy) over an arc around (px, py) that starts at offset
+  // (ox, oy) and turns by angle radians
+  static void _polylineRound(float cx, float cy, float px, float py, float ox, float oy, float angle, Color color) {
+    int segments = _segments(sqrtf(ox * ox + oy * oy), fabsf(angle) / (float)DEG2RAD);
+    float c = cosf(angle / segments);
+    float s = sinf(angle / segments);
+    
+    Vertex *v = _batchBegin(GL_TRIANGLES, 0, segments * 3);
+    for (int i = 0; i < segments; ++i) {
+      float nx = ox * c - oy * s;
+      float ny = ox * s + oy * c;
+      v[i*3] = (Vertex){cx, cy, 0.0f, 0.0f, color};
+      v[i*3+1] = (Vertex){px + ox, py + oy, 0.0f, 0.0f, color};
+      v[i*3+2] = (Vertex){px + nx, py + ny, 0.0f, 0.0f, color};
+      ox = nx;
+      oy = ny;
+    }
+  }
+  
+  void drawPolyline(const float *points, int count, float thickness, Color color) {
+    TRACE_SHAPE_DATA(TRACE_OP_POLYLINE, 0, color, points, count * sizeof(float), count, thickness);
+    int n = count / 2;
+    if (n < 1 || thickness <= 0.0f) { return; }
+    
+    float h = thickness * 0.5f;
+    float margin = h * MINI_MITER_LIMIT + 1.0f;
+    float x0 = points[0], y0 = points[1], x1 = points[0], y1 = points[1];
+    for (int i = 1; i < n; ++i) {
+      x0 = fminf(x0, points[i*2]);
+      y0 = fminf(y0, points[i*2+1]);
+      x1 = fmaxf(x1, points[i*2]);
+      y1 = fmaxf(y1, points[i*2+1]);
+    }
+    if (!_visible(x0 - margin, y0 - margin, x1 + margin, y1 + margin)) { return; }
+    
+    float min2 = line_style.decimate * line_style.decimate;
+    float ax = points[0], ay = points[1];
+    int b = _polylineNext(points, n, 0, min2);
+    
+    // A lone point is only visible through its caps
+    if (b >= n) {
+      if (line_style.cap == CAP_ROUND) {
+        _polylineRound(ax, ay, ax, ay, h, 0.0f, (float)TAU, color);
+      } else if (line_style.cap == CAP_SQUARE) {
+        _batchQuad(0, ax - h, ay - h, thickness, thickness, 0, 0, 0, 0, color);
+      }
+      return;
+    }
+    
+    float bx = points[b*2], by = points[b*2+1];
+    float len = sqrtf((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+    float dx = (bx - ax) / len, dy = (by - ay) / len;
+    float nx = -dy * h, ny = dx * h;
+    
+    if (line_style.cap == CAP_SQUARE) {
+      ax -= dx * h;
+      ay -= dy * h;
+    } else if (line_style.cap == CAP_ROUND) {
+      _polylineRound(ax, ay, ax, ay, nx, ny, (float)PI, color);
+    }
+    
+    // Left and right corners where the current segment starts
+    float lx = ax + nx, ly = ay + ny;
+    float rx = ax - nx, ry = ay - ny;
+    
+    for (;;) {
+      int c = _polylineNext(points, n, b, min2);
+      
+      if (c >= n) {
+        float ex = bx, ey = by;
+        if (line_style.cap == CAP_SQUARE) {
+          ex += dx * h;
+          ey += dy * h;
+        }
+        _batchTriangle(lx, ly, rx, ry, ex - nx, ey - ny, color);
+        _batchTriangle(lx, ly, ex - nx, ey - ny, ex + nx, ey + ny, color);
+        
+        if (line_style.cap == CAP_ROUND) {
+          _polylineRound(bx, by, bx, by, -nx, -ny, (float)PI, color);
+        }
+        return;
+      }
+      
+      float cx = points[c*2], cy = points[c*2+1];
+      float next = sqrtf((cx - bx) * (cx - bx) + (cy - by) * (cy - by));
+      float ex = (cx - bx) / next, ey = (cy - by) / next;
+      float mx = -ey * h, my = ex * h;
+      
+      // side is 1 when the outside of the turn is on the left
+      float cross = dx * ey - dy * ex;
+      float dot = dx * ex + dy * ey;
+      float side = cross > 0.0f ? -1.0f : 1.0f;
+      
+      // Miter offset from the corner: (n0 + n1) * 2h^2 / |n0 + n1|^2
+      float ux = nx + mx, uy = ny + my;
+      float u2 = ux * ux + uy * uy;
+      int miter = u2 > 1e-6f * h * h;
+      float scale = miter ? 2.0f * h * h / u2 : 0.0f;
+      float length = miter ? sqrtf(scale * scale * u2) : 0.0f;
+      
+      float ix = bx - side * ux * scale, iy = by - side * uy * scale;
+      int inner = miter && sqrtf(length * length - h * h) <= fminf(len, next);
+      float px = inner ? ix : bx, py = inner ? iy : by;
+      
+      float o0x = bx + side * nx, o0y = by + side * ny;
+      float o1x = bx + side * mx, o1y = by + side * my;
+      float i0x = inner ? ix : bx - side * nx, i0y = inner ? iy : by - side * ny;
+      float i1x = inner ? ix : bx - side * mx, i1y = inner ? iy : by - side * my;
+      
+      float elx = side > 0.0f ? o0x : i0x, ely = side > 0.0f ? o0y : i0y;
+      float erx = side > 0.0f ? i0x : o0x, ery = side > 0.0f ? i0y : o0y;
+      _batchTriangle(lx, ly, rx, ry, erx, ery, color);
+      _batchTriangle(lx, ly, erx, ery, elx, ely, color);
+      
+      // Straight continuations need no join
+      if (fabsf(cross) > 1e-6f || dot < 0.0f) {
+        if (line_style.join == JOIN_ROUND) {
+          _polylineRound(px, py, bx, by, side * nx, side * ny, atan2f(cross, dot), color);
+        } else if (line_style.join == JOIN_MITER && miter && length <= MINI_MITER_LIMIT * h) {
+          float tx = bx + side * ux * scale, ty = by + side * uy * scale;
+          _batchTriangle(px, py, o0x, o0y, tx, ty, color);
+          _batchTriangle(px, py, tx, ty, o1x, o1y, color);
+        } else {
+          _batchTriangle(px, py, o0x, o0y, o1x, o1y, color);
+        }
+      }
+      
+      lx = side > 0.0f ? o1x : i1x;
+      ly = side > 0.0f ? o1y : i1y;
+      rx = side > 0.0f ? i1x : o1x;
+      ry = side > 0.0f ? i1y : o1y;
+      
+      b = c;
+      bx = cx;
+      by = cy;
+      dx = ex;
+      dy = ey;
+      nx = mx;
+      ny = my;
+      len = next;
+    }
+  }
+  
+  // --- REPLAY --- //
+  // Records are executed through the same internal entry points they were
+  // traced from. Events are pushed back into the queue, so the next
+  // windowUpdate derives the same input state from them.
+  #ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+  #endif
+  
+  int traceOpen(Trace *trace, const char *path) {
+    *trace = (Trace){0};
+    
+    #ifdef _WIN32
+      FILE *file = fopen(path, "rb");
+      if (!file) { return 0; }
+      fseek(file, 0, SEEK_END);
+      long size = ftell(file);
+      fseek(file, 0, SEEK_SET);
+      
+      unsigned char *data = size > 0 ? malloc(size) : NULL;
+      if (size > 0 && !data) { exit(-1); }
+      int ok = size > 0 && fread(data, 1, size, file) == (size_t)size;
+      fclose(file);
+      if (!ok) {
+        free(data);
+        return 0;
+      }
+    #else
+      int fd = open(path, O_RDONLY);
+      if (fd < 0) { return 0; }
+      
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 0;
+      }
+      size_t size = st.st_size;
+      
+      // Pages are faulted in as frames are replayed
+      void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED) { return 0; }
+    #endif
+    
+    trace->data = data;
+    trace->size = size;
+    
+    const TraceHeader *header = (const TraceHeader *)trace->data;
+    if (trace->size < sizeof(TraceHeader) || memcmp(header->magic, TRACE_MAGIC, 8) != 0 || header->version != TRACE_VERSION
+        || header->index > trace->size || header->index % 8 || (trace->size - header->index) / sizeof(unsigned long long) <= header->frames
+        || header->w <= 0 || header->h <= 0 || header->w > 16384 || header->h > 16384) {
+      traceClose(trace);
+      return 0;
+    }
+    
+    trace->index = (const unsigned long long *)(trace->data + header->index);
+    trace->frames = header->frames;
+    trace->w = header->w;
+    trace->h = header->h;
+    return 1;
+  }
+  
+  // Payload bytes a record of op needs, reading its counts only once the
+  // record is known to hold them. A negative or oversized count, or text
+  // without its terminator, needs more than any record has.
+  static size_t _traceNeeds(int op, const unsigned char *payload, size_t size) {
+    const size_t f = sizeof(float);
+    
+    switch (op) {
+      case TRACE_OP_CLEAR: return sizeof(Color);
+      case TRACE_OP_LINE:
+      case TRACE_OP_RECTANGLE: return 4 * f + sizeof(Color);
+      case TRACE_OP_TRIANGLE:
+      case TRACE_OP_ARC: return 6 * f + sizeof(Color);
+      case TRACE_OP_CIRCLE: return 3 * f + sizeof(Color);
+      case TRACE_OP_SLICE: return 5 * f + sizeof(Color);
+      case TRACE_OP_LINE_STYLE: return 3 * f;
+      case TRACE_OP_CLIP: return 4 * f;
+      case TRACE_OP_EVENT: return sizeof(Event);
+      case TRACE_OP_DEPTH:
+      case TRACE_OP_OUTLINE_WIDTH: return f;
+      case TRACE_OP_POLYGON:
+      case TRACE_OP_POLYLINE: {
+        size_t args = op == TRACE_OP_POLYGON ? 1 : 2;
+        if (size < args * f + sizeof(Color)) { return args * f + sizeof(Color); }
+        float count = *(const float *)payload;
+        if (!(count >= 0.0f && count <= (float)(size / f))) { return (size_t)-1; }
+        return args * f + sizeof(Color) + (size_t)count * f;
+      }
+      case TRACE_OP_RECTANGLES:
+      case TRACE_OP_CIRCLES: {
+        size_t components = op == TRACE_OP_RECTANGLES ? 4 : 3;
+        if (size < sizeof(int)) { return sizeof(int); }
+        int n = *(const int *)payload;
+        if (n < 0 || (size_t)n > size) { return (size_t)-1; }
+        return sizeof(int) + (size_t)n * (components * f + sizeof(Color));
+      }
+      case TRACE_OP_TEXT:
+        if (size <= 3 * f + sizeof(Color)) { return 3 * f + sizeof(Color) + 1; }
+        return memchr(payload + 3 * f + sizeof(Color), 0, size - 3 * f - sizeof(Color)) ? size : (size_t)-1;
+    }
+    return 0;
+  }
+  
+  void traceReplay(const Trace *trace, int frame) {
+    if (frame < 0 || frame >= trace->frames) { return; }
+    if (trace->index[frame] > trace->index[frame + 1] || trace->index[frame + 1] > trace->size) { return; }
+    if (trace->index[frame] % 8) { return; }
+    
+    const unsigned char *p = trace->data + trace->index[frame];
+    const unsigned char *end = trace->data + trace->index[frame + 1];
+    
+    while ((size_t)(end - p) >= sizeof(TraceRecord)) {
+      const TraceRecord *record = (const TraceRecord *)p;
+      const unsigned char *payload = p + sizeof(TraceRecord);
+      if (record->size > (size_t)(end - payload) || record->size % 8) { return; }
+      if (_traceNeeds(record->op, payload, record->size) > record->size) { return; }
+      p = payload + record->size;
+      
+      // Float arguments first, then the color, then any trailing data
+      const float *f = (const float *)payload;
+      int mode = record->mode;
+      Color color;
+      
+      switch (record->op) {
+        case TRACE_OP_CLEAR:
+          memcpy(&color, payload, sizeof(Color));
+          windowClear(color);
+          break;
+        case TRACE_OP_LINE:
+          memcpy(&color, f + 4, sizeof(Color));
+          drawLine(f[0], f[1], f[2], f[3], color);
+          break;
+        case TRACE_OP_TRIANGLE:
+          memcpy(&color, f + 6, sizeof(Color));
+          _drawTriangle(f[0], f[1], f[2], f[3], f[4], f[5], color, mode);
+          break;
+        case TRACE_OP_RECTANGLE:
+          memcpy(&color, f + 4, sizeof(Color));
+          _drawRectangle(f[0], f[1], f[2], f[3], color, mode);
+          break;
+        case TRACE_OP_POLYGON:
+          memcpy(&color, f + 1, sizeof(Color));
+          _drawPolygon((float *)(f + 2), (int)f[0], color, mode);
+          break;
+        case TRACE_OP_CIRCLE:
+          memcpy(&color, f + 3, sizeof(Color));
+          _drawCircle(f[0], f[1], f[2], color, mode);
+          break;
+        case TRACE_OP_SLICE:
+          memcpy(&color, f + 5, sizeof(Color));
+          _drawSlice(f[0], f[1], f[2], f[3], f[4], color, mode);
+          break;
+        case TRACE_OP_ARC:
+          memcpy(&color, f + 6, sizeof(Color));
+          _drawArc(f[0], f[1], f[2], f[3], f[4], f[5], color, mode);
+          break;
+        case TRACE_OP_RECTANGLES: {
+          int n = *(const int *)payload;
+          drawRectanglesFilled(f + 1, (const Color *)(f + 1 + n * 4), n);
+          break;
+        }
+        case TRACE_OP_CIRCLES: {
+          int n = *(const int *)payload;
+          drawCirclesFilled(f + 1, (const Color *)(f + 1 + n * 3), n);
+          break;
+        }
+        case TRACE_OP_POLYLINE:
+          memcpy(&color, f + 2, sizeof(Color));
+          drawPolyline(f + 3, (int)f[0], f[1], color);
+          break;
+        case TRACE_OP_LINE_STYLE:
+          lineStyle((LineJoin)f[0], (LineCap)f[1], f[2]);
+          break;
+        case TRACE_OP_OUTLINE_WIDTH:
+          outlineWidth(f[0]);
+          break;
+        case TRACE_OP_TEXT:
+          #ifdef MINI_FONTS
+            memcpy(&color, f + 3, sizeof(Color));
+            drawText((const char *)(f + 4), f[0], f[1], f[2], color);
+          #endif
+          break;
+        case TRACE_OP_CLIP:
+          clipSet(f[0], f[1], f[2], f[3]);
+          break;
+        case TRACE_OP_CLIP_RESET:
+          clipReset();
+          break;
+        case TRACE_OP_EVENT: {
+          Event event;
+          memcpy(&event, payload, sizeof(Event));
+          eventPush(event);
+          break;
+        }
+        case TRACE_OP_DEPTH:
+          #ifdef MINI_QUEUE
+            drawDepth((int)f[0]);
+          #endif
+          break;
+      }
+    }
+  }
+  
+  void traceClose(Trace *trace) {
+    if (trace->data) {
+      #ifdef _WIN32
+        free((void *)trace->data);
+      #else
+        munmap((void *)trace->data, trace->size);
+      #endif
+    }
+    *trace = (Trace){0};
+  }
 
 #endif // MINI_IMPLEMENTATION
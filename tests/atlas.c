@@ -0,0 +1,61 @@
+// Atlas packing check
+//
+// Packs images of random sizes into small atlases until they fill up and
+// fails if any two returned sprites, padding excluded, share a texel or if
+// one leaves the atlas. Runs headless against the software backend.
+
+#define MINI_IMPLEMENTATION
+#include "../miniengine.h"
+
+static unsigned int seed = 12345;
+static int randi(int lo, int hi) {
+  seed = seed * 1664525u + 1013904223u;
+  return lo + (int)((seed >> 8) % (unsigned int)(hi - lo + 1));
+}
+
+static int overlaps(const Sprite *a, const Sprite *b) {
+  return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+int main() {
+  windowInit(64, 64, "atlas");
+  
+  static unsigned char pixels[30 * 30 * 4];
+  static Sprite sprites[4096];
+  int failures = 0;
+  
+  for (int run = 0; run < 50; ++run) {
+    int size = run % 2 ? 256 : 128;
+    Atlas atlas;
+    atlasInit(&atlas, size, size);
+    
+    int count = 0;
+    for (int misses = 0; misses < 200 && count < 4096;) {
+      int w = randi(1, 30);
+      int h = randi(1, 30);
+      Sprite sprite;
+      if (!atlasAdd(&atlas, pixels, w, h, &sprite)) {
+        misses++;
+        continue;
+      }
+      
+      if (sprite.x < 0 || sprite.y < 0 || sprite.x + sprite.w > size || sprite.y + sprite.h > size) {
+        printf("run %d: (%d,%d %dx%d) outside the atlas\n", run, sprite.x, sprite.y, sprite.w, sprite.h);
+        failures++;
+      }
+      for (int i = 0; i < count; ++i) {
+        if (overlaps(&sprite, &sprites[i])) {
+          printf("run %d: (%d,%d %dx%d) overlaps (%d,%d %dx%d)\n", run, sprite.x, sprite.y, sprite.w, sprite.h,
+                 sprites[i].x, sprites[i].y, sprites[i].w, sprites[i].h);
+          failures++;
+        }
+      }
+      sprites[count++] = sprite;
+    }
+    atlasFree(&atlas);
+  }
+  
+  windowClose();
+  printf("%s\n", failures ? "FAIL" : "ok");
+  return failures != 0;
+}